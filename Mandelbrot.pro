@@ -32,7 +32,16 @@ SOURCES += \
     axiswidget.cpp \
     mandelbrotview.cpp \
     mandelbrotthemeinfo.cpp \
-    mandelbrottheme.cpp
+    mandelbrottheme.cpp \
+    mandelbrottilescheduler.cpp \
+    mandelbrotkernel.cpp \
+    mandelbrotsimdkernel.cpp \
+    mandelbrotbigfloat.cpp \
+    mandelbrotviewport.cpp \
+    mandelbrotperturbation.cpp \
+    mandelbrotpointbuffer.cpp \
+    mandelbrotrenderengine.cpp \
+    mandelbrottilequeue.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -42,12 +51,26 @@ HEADERS += \
     axiswidget.h \
     mandelbrotview.h \
     mandelbrotthemeinfo.h \
-    mandelbrottheme.h
+    mandelbrottheme.h \
+    mandelbrottilescheduler.h \
+    mandelbrotkernel.h \
+    mandelbrotsimdkernel.h \
+    mandelbrotbigfloat.h \
+    mandelbrotviewport.h \
+    mandelbrotperturbation.h \
+    mandelbrotdoubledouble.h \
+    mandelbrotpointbuffer.h \
+    mandelbrotrenderengine.h \
+    mandelbrottilequeue.h
 
 FORMS += \
         mainwindow.ui \
     mandelbrotthemedialog.ui \
     mandelbrotview.ui
 
+# Keep the scalar and the vectorized convergence tests bit-identical:
+# do not let the compiler fuse multiplications and additions.
+*-g++*|*-clang*: QMAKE_CXXFLAGS += -ffp-contract=off
+
 RESOURCES += \
     cursor.qrc
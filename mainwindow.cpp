@@ -3,9 +3,8 @@
 
 #include "mandelbrotthememanager.h"
 #include "mandelbrotthemedialog.h"
+#include "mandelbrotrenderengine.h"
 
-#include <QFuture>
-#include <QtConcurrent>
 #include <QPixmap>
 #include <QCloseEvent>
 #include <QImageWriter>
@@ -24,7 +23,8 @@ MainWindow::MainWindow(QWidget *parent) :
 {
     ui->setupUi(this);
 
-    m_mandelbrotSet = ui->mandelbrotView->getMandelbrotSet();
+    m_renderEngine = ui->mandelbrotView->getRenderEngine();
+    m_mandelbrotSet = m_renderEngine->getMandelbrotSet();
     m_themeManager = m_mandelbrotSet->getThemeManager();
 
     QStringList themes = m_themeManager->getThemes();
@@ -36,10 +36,12 @@ MainWindow::MainWindow(QWidget *parent) :
 
     connect(m_mandelbrotSet, SIGNAL(progressChanged(int)),
             this, SLOT(onProgressChanged(int)));
-    connect(m_mandelbrotSet, SIGNAL(pixmapReady()),
-            this, SLOT(doneUpdate()));
-    connect(ui->mandelbrotView, SIGNAL(updateNeeded(double, double, double, double)),
-            this, SLOT(startUpdate(double, double, double, double)));
+    // Connected after the view, which displays the image first.
+    connect(m_renderEngine, SIGNAL(imageReady(QImage,MandelbrotRenderResult)),
+            this, SLOT(onImageReady(QImage,MandelbrotRenderResult)));
+    qRegisterMetaType<MandelbrotViewport>("MandelbrotViewport");
+    connect(ui->mandelbrotView, SIGNAL(updateNeeded(MandelbrotViewport,bool)),
+            this, SLOT(startUpdate(MandelbrotViewport,bool)));
 }
 
 MainWindow::~MainWindow()
@@ -72,12 +74,28 @@ void MainWindow::on_unzoomButton_clicked()
     ui->mandelbrotView->unzoom();
 }
 
+/**
+ * @param checked true for the pan mode.
+ */
+void MainWindow::on_panButton_toggled(bool checked)
+{
+    ui->mandelbrotView->setPanMode(checked);
+}
+
+/**
+ * @param checked true to keep the orbits.
+ */
+void MainWindow::on_resumableCheckBox_toggled(bool checked)
+{
+    m_renderEngine->setResumable(checked);
+}
+
 /**
  * @param arg1 Order of the mandelbrot set.
  */
 void MainWindow::on_orderSpinBox_valueChanged(double arg1)
 {
-    m_mandelbrotSet->setOrder(arg1);
+    m_renderEngine->setOrder(arg1);
 }
 
 /**
@@ -91,19 +109,15 @@ void MainWindow::on_precisionSpinBox_valueChanged(int arg1)
     else if(arg1 < 10000) ui->precisionSpinBox->setSingleStep(1000);
     else if(arg1 < 100000) ui->precisionSpinBox->setSingleStep(10000);
     else ui->precisionSpinBox->setSingleStep(100000);
-    m_mandelbrotSet->setPrecision(arg1);
+    m_renderEngine->setPrecision(arg1);
 }
 
 void MainWindow::on_updateButton_clicked()
 {
     if(ui->updateButton->text() == "Update") {
-        double xmin = m_mandelbrotSet->getXmin();
-        double xmax = m_mandelbrotSet->getXmax();
-        double ymin = m_mandelbrotSet->getYmin();
-        double ymax = m_mandelbrotSet->getYmax();
-        startUpdate(xmin, xmax, ymin, ymax);
+        startUpdate(ui->mandelbrotView->getViewport());
     }else{
-        m_mandelbrotSet->cancel();
+        ui->mandelbrotView->cancel();
         doneUpdate();
     }
 }
@@ -139,18 +153,62 @@ void MainWindow::on_editThemeButton_clicked()
  * - Change the "Update" button into a "Stop" button,
  * allowing to abort the calculation at any time.
  *
- * @param xmin Start of the x coordinate range in the complex plane.
- * @param xmax End of the x coordinate range in the complex plane.
- * @param ymin Start of the y coordinate range in the complex plane.
- * @param ymax End of the y coordinate range in the complex plane.
+ * @param viewport Region of the complex plane to be rendered.
+ * @param isPreview true for a quick preview of an interaction. Default is false.
  */
-void MainWindow::startUpdate(double xmin, double xmax, double ymin, double ymax)
+void MainWindow::startUpdate(const MandelbrotViewport &viewport, bool isPreview)
 {
     ui->saveButton->setEnabled(false);
     ui->actionSave->setEnabled(false);
     ui->updateButton->setText("Stop");
-    QtConcurrent::run(ui->mandelbrotView, &MandelbrotView::update,
-                      xmin, xmax, ymin, ymax);
+    ui->mandelbrotView->update(viewport, isPreview);
+}
+
+/**
+ * The report is read from the result: the set may already be computing the next image.
+ *
+ * @param image Complete image, displayed by the view.
+ * @param result Description of the image.
+ */
+void MainWindow::onImageReady(const QImage &image, const MandelbrotRenderResult &result)
+{
+    Q_UNUSED(image);
+
+    QString zoomText;
+    zoomText.sprintf("x %g", result.viewport.getZoomFactor());
+    ui->scaleLabel->setText(zoomText);
+    QString precisionTier = MandelbrotSet::getPrecisionTierName(result.precisionTier);
+    ui->precisionTierLabel->setText(precisionTier);
+    ui->precisionTierLabel->setToolTip(result.precisionTierReason);
+
+    // The share of time the threads spend busy tells how well the load is balanced.
+    const std::vector<MandelbrotWorkerStats> &workerStats = result.workerStats;
+    qint64 busyTime = 0;
+    qint64 totalTime = 0;
+    QString workerReport;
+    for(size_t k=0; k<workerStats.size(); k++) {
+        busyTime += workerStats[k].busyTime;
+        totalTime += workerStats[k].busyTime + workerStats[k].idleTime;
+        workerReport += QString("Thread %1: busy %2 ms, idle %3 ms, %4 tiles, predicted cost %5\n")
+                .arg(k)
+                .arg(workerStats[k].busyTime / 1000000.0, 0, 'f', 1)
+                .arg(workerStats[k].idleTime / 1000000.0, 0, 'f', 1)
+                .arg(workerStats[k].nTiles)
+                .arg(workerStats[k].predictedCost, 0, 'g', 3);
+    }
+    double busyRatio = totalTime > 0 ? 100.0 * busyTime / totalTime : 100;
+
+    ui->statusBar->showMessage(QString("Arithmetic: %1 (%2). Iterations saved by periodicity checks: %3, by series approximation: %4. "
+                                       "Memory: %5 bytes per pixel. Threads busy %6% of the time")
+                               .arg(precisionTier)
+                               .arg(result.precisionTierReason)
+                               .arg(result.skippedIterations)
+                               .arg(result.approximatedIterations)
+                               .arg(result.bytesPerPixel, 0, 'f', 1)
+                               .arg(busyRatio, 0, 'f', 0));
+    ui->statusBar->setToolTip(workerReport.trimmed());
+
+    doneUpdate();
 }
 
 /**
@@ -166,9 +224,6 @@ void MainWindow::doneUpdate()
         ui->saveButton->setEnabled(true);
         ui->actionSave->setEnabled(true);
     }
-    QString zoomText;
-    zoomText.sprintf("x %g", m_mandelbrotSet->getZoomFactor());
-    ui->scaleLabel->setText(zoomText);
     ui->updateButton->setText("Update");
 }
 
@@ -218,7 +273,7 @@ void MainWindow::save()
  */
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    m_mandelbrotSet->cancel();
+    ui->mandelbrotView->cancel();
     doneUpdate();
 
     event->accept();
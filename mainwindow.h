@@ -5,6 +5,7 @@
 #include <QProgressDialog>
 
 #include "mandelbrotset.h"
+#include "mandelbrotrenderengine.h"
 
 namespace Ui {
 class MainWindow;
@@ -48,6 +49,12 @@ private slots:
     /** Respond to unzoom button: reset the zoom to 1. */
     void on_unzoomButton_clicked();
 
+    /** Respond to pan button: switch between moving the image and zooming in. */
+    void on_panButton_toggled(bool checked);
+
+    /** Respond to resumable checkbox: keep the orbits to resume them when the precision is raised. */
+    void on_resumableCheckBox_toggled(bool checked);
+
     /** Respond to the order spin box: change the order of the mandelbrot set. */
     void on_orderSpinBox_valueChanged(double arg1);
 
@@ -64,9 +71,12 @@ private slots:
     void on_editThemeButton_clicked();
 
     /** Respond to the updateNeeded() signal: starts updating the mandelbrot set. */
-    void startUpdate(double xmin, double xmax, double ymin, double ymax);
+    void startUpdate(const MandelbrotViewport &viewport, bool isPreview = false);
+
+    /** Respond to the imageReady() signal: report how the image was computed. */
+    void onImageReady(const QImage &image, const MandelbrotRenderResult &result);
 
-    /** Respond to the pixmapReady() signal: update the GUI when a new set is ready. */
+    /** Reset the GUI once the calculation is done or stopped. */
     void doneUpdate();
 
     /** Respond to the progressChanged() signal: update the progress bar. */
@@ -82,6 +92,7 @@ private:
 
     Ui::MainWindow *ui; //!< User interface object.
 
+    MandelbrotRenderEngine *m_renderEngine; //!< Engine rendering the images of the view.
     MandelbrotSet *m_mandelbrotSet; //!< A Mandelbrot set.
     MandelbrotThemeManager *m_themeManager; //!< A theme manager.
     QString m_currentDir; //!< Last open directory by the save file dialog.
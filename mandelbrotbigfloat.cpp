@@ -0,0 +1,203 @@
+#include "mandelbrotbigfloat.h"
+
+#include <math.h>
+
+MandelbrotBigFloat::MandelbrotBigFloat()
+{
+    m_isNegative = false;
+    m_limbs.resize(1, 0);
+}
+
+/**
+ * The conversion is exact as long as the number of fractional limbs
+ * is large enough to hold all the bits of x.
+ *
+ * @param x A number whose integer part fits in 32 bits.
+ * @param nFractionLimbs Number of 32-bit limbs in the fractional part.
+ */
+MandelbrotBigFloat::MandelbrotBigFloat(double x, int nFractionLimbs)
+{
+    m_isNegative = x < 0;
+    m_limbs.resize(1 + nFractionLimbs, 0);
+
+    double value = fabs(x);
+    double integerPart = floor(value);
+    m_limbs[0] = (quint32)integerPart;
+    value -= integerPart;
+    for(int k=1; k<=nFractionLimbs && value > 0; k++) {
+        value = ldexp(value, 32);
+        double limb = floor(value);
+        m_limbs[k] = (quint32)limb;
+        value -= limb;
+    }
+}
+
+int MandelbrotBigFloat::getNFractionLimbs() const
+{
+    return m_limbs.size() - 1;
+}
+
+/**
+ * @param nFractionLimbs New number of 32-bit limbs in the fractional part.
+ * Extra limbs are set to zero, missing ones are truncated.
+ */
+void MandelbrotBigFloat::setNFractionLimbs(int nFractionLimbs)
+{
+    m_limbs.resize(1 + nFractionLimbs, 0);
+}
+
+/**
+ * Only the three most significant non-zero limbs are used,
+ * which is more than the 53 bits of a double.
+ *
+ * @return The nearest double.
+ */
+double MandelbrotBigFloat::toDouble() const
+{
+    int nLimbs = m_limbs.size();
+    int first = 0;
+    while(first < nLimbs && m_limbs[first] == 0) first++;
+
+    double x = 0;
+    for(int k=first; k<nLimbs && k<first+3; k++) {
+        x += ldexp((double)m_limbs[k], -32*k);
+    }
+    return m_isNegative ? -x : x;
+}
+
+MandelbrotBigFloat MandelbrotBigFloat::operator+(const MandelbrotBigFloat &other) const
+{
+    int nFractionLimbs = std::max(getNFractionLimbs(), other.getNFractionLimbs());
+    MandelbrotBigFloat a = *this;
+    MandelbrotBigFloat b = other;
+    a.setNFractionLimbs(nFractionLimbs);
+    b.setNFractionLimbs(nFractionLimbs);
+
+    MandelbrotBigFloat result;
+    if(a.m_isNegative == b.m_isNegative) {
+        result.m_isNegative = a.m_isNegative;
+        result.m_limbs = addMagnitude(a.m_limbs, b.m_limbs);
+    }else if(compareMagnitude(a.m_limbs, b.m_limbs) >= 0) {
+        result.m_isNegative = a.m_isNegative;
+        result.m_limbs = subtractMagnitude(a.m_limbs, b.m_limbs);
+    }else{
+        result.m_isNegative = b.m_isNegative;
+        result.m_limbs = subtractMagnitude(b.m_limbs, a.m_limbs);
+    }
+    if(result.isZero()) result.m_isNegative = false;
+    return result;
+}
+
+MandelbrotBigFloat MandelbrotBigFloat::operator-(const MandelbrotBigFloat &other) const
+{
+    return *this + (-other);
+}
+
+MandelbrotBigFloat MandelbrotBigFloat::operator-() const
+{
+    MandelbrotBigFloat result = *this;
+    result.m_isNegative = !m_isNegative && !isZero();
+    return result;
+}
+
+/**
+ * Schoolbook multiplication. Bits beyond the precision of the most precise
+ * operand are truncated, as well as bits beyond the 32-bit integer part.
+ */
+MandelbrotBigFloat MandelbrotBigFloat::operator*(const MandelbrotBigFloat &other) const
+{
+    int na = m_limbs.size();
+    int nb = other.m_limbs.size();
+    int nFractionLimbs = std::max(na, nb) - 1;
+
+    // Least significant limb first: product[k] has a weight of 2^(32*(k-(na-1)-(nb-1))).
+    std::vector<quint32> product(na + nb, 0);
+    for(int i=0; i<na; i++) {
+        quint64 ai = m_limbs[na-1-i];
+        if(ai == 0) continue;
+        quint64 carry = 0;
+        for(int j=0; j<nb; j++) {
+            quint64 t = ai * other.m_limbs[nb-1-j] + product[i+j] + carry;
+            product[i+j] = (quint32)t;
+            carry = t >> 32;
+        }
+        product[i+nb] += (quint32)carry;
+    }
+
+    MandelbrotBigFloat result;
+    result.m_limbs.resize(1 + nFractionLimbs);
+    int integerIndex = (na - 1) + (nb - 1);
+    for(int k=0; k<=nFractionLimbs; k++) {
+        result.m_limbs[k] = product[integerIndex - k];
+    }
+    result.m_isNegative = (m_isNegative != other.m_isNegative) && !result.isZero();
+    return result;
+}
+
+bool MandelbrotBigFloat::operator==(const MandelbrotBigFloat &other) const
+{
+    int nFractionLimbs = std::max(getNFractionLimbs(), other.getNFractionLimbs());
+    MandelbrotBigFloat a = *this;
+    MandelbrotBigFloat b = other;
+    a.setNFractionLimbs(nFractionLimbs);
+    b.setNFractionLimbs(nFractionLimbs);
+    return a.m_isNegative == b.m_isNegative && a.m_limbs == b.m_limbs;
+}
+
+bool MandelbrotBigFloat::operator!=(const MandelbrotBigFloat &other) const
+{
+    return !(*this == other);
+}
+
+/**
+ * Two extra limbs are kept as a safety margin.
+ *
+ * @param resolution Smallest distance to be resolved, e.g. the size of a pixel.
+ * @return The number of fractional limbs.
+ */
+int MandelbrotBigFloat::getNFractionLimbsFor(double resolution)
+{
+    if(resolution <= 0) return 2;
+    int bits = (int)ceil(-log2(resolution));
+    return std::max(bits, 0) / 32 + 3;
+}
+
+int MandelbrotBigFloat::compareMagnitude(const std::vector<quint32> &a, const std::vector<quint32> &b)
+{
+    for(unsigned int k=0; k<a.size(); k++) {
+        if(a[k] != b[k]) return a[k] < b[k] ? -1 : 1;
+    }
+    return 0;
+}
+
+std::vector<quint32> MandelbrotBigFloat::addMagnitude(const std::vector<quint32> &a, const std::vector<quint32> &b)
+{
+    std::vector<quint32> result(a.size());
+    quint64 carry = 0;
+    for(int k=a.size()-1; k>=0; k--) {
+        quint64 t = (quint64)a[k] + b[k] + carry;
+        result[k] = (quint32)t;
+        carry = t >> 32;
+    }
+    return result;
+}
+
+std::vector<quint32> MandelbrotBigFloat::subtractMagnitude(const std::vector<quint32> &a, const std::vector<quint32> &b)
+{
+    std::vector<quint32> result(a.size());
+    qint64 borrow = 0;
+    for(int k=a.size()-1; k>=0; k--) {
+        qint64 t = (qint64)a[k] - b[k] - borrow;
+        borrow = t < 0 ? 1 : 0;
+        result[k] = (quint32)(t + (borrow << 32));
+    }
+    return result;
+}
+
+bool MandelbrotBigFloat::isZero() const
+{
+    for(unsigned int k=0; k<m_limbs.size(); k++) {
+        if(m_limbs[k] != 0) return false;
+    }
+    return true;
+}
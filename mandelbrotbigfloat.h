@@ -0,0 +1,81 @@
+#ifndef MANDELBROTBIGFLOAT_H
+#define MANDELBROTBIGFLOAT_H
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief The MandelbrotBigFloat class.
+ *
+ * A signed fixed-point number of arbitrary precision.
+ *
+ * The magnitude is stored as 32-bit limbs, most significant first:
+ * the first limb holds the integer part and the following ones hold
+ * the fractional part, each limb adding 32 bits of precision.
+ * This is enough to hold coordinates in the complex plane at any zoom level,
+ * the integer part of the numbers involved being always small.
+ *
+ * The result of an operation has the precision of its most precise operand.
+ * Multiplications are truncated to that precision.
+ */
+class MandelbrotBigFloat
+{
+public:
+
+    /** Constructor: zero. */
+    MandelbrotBigFloat();
+
+    /** Constructor from a double, with a given number of fractional limbs. */
+    explicit MandelbrotBigFloat(double x, int nFractionLimbs = 2);
+
+    /** Get the number of 32-bit limbs in the fractional part. */
+    int getNFractionLimbs() const;
+
+    /** Change the number of 32-bit limbs in the fractional part. */
+    void setNFractionLimbs(int nFractionLimbs);
+
+    /** Convert to the nearest double. */
+    double toDouble() const;
+
+    /** Add two numbers. */
+    MandelbrotBigFloat operator+(const MandelbrotBigFloat &other) const;
+
+    /** Subtract two numbers. */
+    MandelbrotBigFloat operator-(const MandelbrotBigFloat &other) const;
+
+    /** Negate a number. */
+    MandelbrotBigFloat operator-() const;
+
+    /** Multiply two numbers. */
+    MandelbrotBigFloat operator*(const MandelbrotBigFloat &other) const;
+
+    /** Check if two numbers are equal. */
+    bool operator==(const MandelbrotBigFloat &other) const;
+
+    /** Check if two numbers are different. */
+    bool operator!=(const MandelbrotBigFloat &other) const;
+
+    /** Get the number of fractional limbs needed to resolve a given distance. */
+    static int getNFractionLimbsFor(double resolution);
+
+protected:
+
+    /** Compare the magnitudes of two numbers with the same precision. */
+    static int compareMagnitude(const std::vector<quint32> &a, const std::vector<quint32> &b);
+
+    /** Add the magnitudes of two numbers with the same precision. */
+    static std::vector<quint32> addMagnitude(const std::vector<quint32> &a, const std::vector<quint32> &b);
+
+    /** Subtract the magnitudes of two numbers with the same precision, a being the largest. */
+    static std::vector<quint32> subtractMagnitude(const std::vector<quint32> &a, const std::vector<quint32> &b);
+
+    /** Check if the magnitude is zero. */
+    bool isZero() const;
+
+    bool m_isNegative; //!< Sign of the number.
+    std::vector<quint32> m_limbs; //!< Magnitude: integer part followed by the fractional part.
+};
+
+#endif // MANDELBROTBIGFLOAT_H
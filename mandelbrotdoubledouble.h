@@ -0,0 +1,122 @@
+#ifndef MANDELBROTDOUBLEDOUBLE_H
+#define MANDELBROTDOUBLEDOUBLE_H
+
+#if defined(__GNUC__)
+#define MANDELBROT_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define MANDELBROT_ALWAYS_INLINE inline
+#endif
+
+/**
+ * @brief The MandelbrotDoubleDouble structure.
+ *
+ * A double-double number: the unevaluated sum of two doubles
+ * where the low part holds the rounding error of the high part.
+ * This gives about 106 bits of precision, twice as many as a double,
+ * at the cost of about ten floating-point operations per operation.
+ *
+ * The operations rely on Dekker's error-free transformations and
+ * do not require fused multiply-add instructions. They need however
+ * every operation to be rounded on its own: the compiler must not
+ * contract multiplications and additions (see Mandelbrot.pro).
+ *
+ * The type of the parts is a template parameter, so that the same
+ * code handles single numbers (double) and vectors of numbers
+ * (see MandelbrotSimdKernel).
+ */
+template<typename T>
+struct MandelbrotDoubleDouble {
+
+    T hi; //!< High part: the number rounded to the nearest double.
+    T lo; //!< Low part: the rounding error of the high part.
+
+    /** Constructor: zero. */
+    MandelbrotDoubleDouble() : hi(), lo() {}
+
+    /** Constructor from both parts. */
+    MandelbrotDoubleDouble(const T &high, const T &low) : hi(high), lo(low) {}
+
+    /** Add two numbers. */
+    MANDELBROT_ALWAYS_INLINE MandelbrotDoubleDouble operator+(const MandelbrotDoubleDouble &b) const
+    {
+        T s1, s2, t1, t2;
+        twoSum(hi, b.hi, s1, s2);
+        twoSum(lo, b.lo, t1, t2);
+        s2 = s2 + t1;
+        quickTwoSum(s1, s2, s1, s2);
+        s2 = s2 + t2;
+        MandelbrotDoubleDouble r;
+        quickTwoSum(s1, s2, r.hi, r.lo);
+        return r;
+    }
+
+    /** Add a double. */
+    MANDELBROT_ALWAYS_INLINE MandelbrotDoubleDouble operator+(const T &b) const
+    {
+        T s1, s2;
+        twoSum(hi, b, s1, s2);
+        s2 = s2 + lo;
+        MandelbrotDoubleDouble r;
+        quickTwoSum(s1, s2, r.hi, r.lo);
+        return r;
+    }
+
+    /** Subtract two numbers. */
+    MANDELBROT_ALWAYS_INLINE MandelbrotDoubleDouble operator-(const MandelbrotDoubleDouble &b) const
+    {
+        return *this + MandelbrotDoubleDouble(-b.hi, -b.lo);
+    }
+
+    /** Multiply two numbers. */
+    MANDELBROT_ALWAYS_INLINE MandelbrotDoubleDouble operator*(const MandelbrotDoubleDouble &b) const
+    {
+        T p, e;
+        twoProd(hi, b.hi, p, e);
+        e = e + (hi * b.lo + lo * b.hi);
+        MandelbrotDoubleDouble r;
+        quickTwoSum(p, e, r.hi, r.lo);
+        return r;
+    }
+
+    /** Multiply by two, which is exact. */
+    MANDELBROT_ALWAYS_INLINE MandelbrotDoubleDouble twice() const
+    {
+        return MandelbrotDoubleDouble(hi + hi, lo + lo);
+    }
+
+    /** Sum of two doubles with its rounding error. */
+    static MANDELBROT_ALWAYS_INLINE void twoSum(const T &a, const T &b, T &s, T &err)
+    {
+        s = a + b;
+        T bb = s - a;
+        err = (a - (s - bb)) + (b - bb);
+    }
+
+    /** Sum of two doubles with its rounding error, the first one being the largest. */
+    static MANDELBROT_ALWAYS_INLINE void quickTwoSum(const T &a, const T &b, T &s, T &err)
+    {
+        T sum = a + b;
+        err = b - (sum - a);
+        s = sum;
+    }
+
+    /** Split a double into two halves of 26 bits. */
+    static MANDELBROT_ALWAYS_INLINE void split(const T &a, T &high, T &low)
+    {
+        T t = 134217729. * a;
+        high = t - (t - a);
+        low = a - high;
+    }
+
+    /** Product of two doubles with its rounding error. */
+    static MANDELBROT_ALWAYS_INLINE void twoProd(const T &a, const T &b, T &p, T &err)
+    {
+        T ahi, alo, bhi, blo;
+        split(a, ahi, alo);
+        split(b, bhi, blo);
+        p = a * b;
+        err = ((ahi * bhi - p) + ahi * blo + alo * bhi) + alo * blo;
+    }
+};
+
+#endif // MANDELBROTDOUBLEDOUBLE_H
@@ -0,0 +1,270 @@
+#include "mandelbrotkernel.h"
+
+namespace {
+
+/**
+ * @param order Order of the set.
+ * @return A specialized test for integer orders between 2 and 8, the general test otherwise.
+ */
+template<int Fields>
+MandelbrotKernel::ConvergenceTest selectTest(double order)
+{
+    if(order != floor(order)) {
+        return &MandelbrotKernel::generalTest<Fields>;
+    }
+
+    switch((int)order) {
+    case 2: return &MandelbrotKernel::integerTest<2, Fields>;
+    case 3: return &MandelbrotKernel::integerTest<3, Fields>;
+    case 4: return &MandelbrotKernel::integerTest<4, Fields>;
+    case 5: return &MandelbrotKernel::integerTest<5, Fields>;
+    case 6: return &MandelbrotKernel::integerTest<6, Fields>;
+    case 7: return &MandelbrotKernel::integerTest<7, Fields>;
+    case 8: return &MandelbrotKernel::integerTest<8, Fields>;
+    default: return &MandelbrotKernel::generalTest<Fields>;
+    }
+}
+
+/**
+ * @param order Order of the set.
+ * @return A specialized test for integer orders between 2 and 8, the general test otherwise.
+ */
+template<int Fields>
+MandelbrotKernel::ResumableTest selectResumableTest(double order)
+{
+    if(order != floor(order)) {
+        return &MandelbrotKernel::resumableGeneralTest<Fields>;
+    }
+
+    switch((int)order) {
+    case 2: return &MandelbrotKernel::resumableIntegerTest<2, Fields>;
+    case 3: return &MandelbrotKernel::resumableIntegerTest<3, Fields>;
+    case 4: return &MandelbrotKernel::resumableIntegerTest<4, Fields>;
+    case 5: return &MandelbrotKernel::resumableIntegerTest<5, Fields>;
+    case 6: return &MandelbrotKernel::resumableIntegerTest<6, Fields>;
+    case 7: return &MandelbrotKernel::resumableIntegerTest<7, Fields>;
+    case 8: return &MandelbrotKernel::resumableIntegerTest<8, Fields>;
+    default: return &MandelbrotKernel::resumableGeneralTest<Fields>;
+    }
+}
+
+}
+
+/**
+ * @param order Order of the set.
+ * @param fields Fields of the results to be filled, as MandelbrotSet::PointField flags.
+ * @return A specialized test for integer orders between 2 and 8, the general test otherwise.
+ */
+MandelbrotKernel::ConvergenceTest MandelbrotKernel::select(double order, int fields)
+{
+    switch(fields) {
+    case MandelbrotSet::EscapeTimeOnly: return selectTest<MandelbrotSet::EscapeTimeOnly>(order);
+    case MandelbrotSet::RadiusField: return selectTest<MandelbrotSet::RadiusField>(order);
+    case MandelbrotSet::DistanceField: return selectTest<MandelbrotSet::DistanceField>(order);
+    default: return selectTest<MandelbrotSet::AllFields>(order);
+    }
+}
+
+/**
+ * @param order Order of the set.
+ * @param fields Fields of the results to be filled, as MandelbrotSet::PointField flags.
+ * @return A specialized test for integer orders between 2 and 8, the general test otherwise.
+ */
+MandelbrotKernel::ResumableTest MandelbrotKernel::selectResumable(double order, int fields)
+{
+    switch(fields) {
+    case MandelbrotSet::EscapeTimeOnly: return selectResumableTest<MandelbrotSet::EscapeTimeOnly>(order);
+    case MandelbrotSet::RadiusField: return selectResumableTest<MandelbrotSet::RadiusField>(order);
+    case MandelbrotSet::DistanceField: return selectResumableTest<MandelbrotSet::DistanceField>(order);
+    default: return selectResumableTest<MandelbrotSet::AllFields>(order);
+    }
+}
+
+/**
+ * @param x0 Real part of the point.
+ * @param y0 Imaginary part of the point.
+ * @param params Settings of the calculation.
+ * @param stats Statistics to be updated.
+ * @return The result of the convergence test.
+ */
+template<int Fields>
+MandelbrotKernel::MandelbrotPoint MandelbrotKernel::generalTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                                                MandelbrotKernelStats &stats)
+{
+    MandelbrotPoint p;
+    MandelbrotOrbitState state;
+    state.n = 0;
+    resumableGeneralTest<Fields>(x0, y0, params, stats, p, state);
+    return p;
+}
+
+/**
+ * @param x0 Real part of the point.
+ * @param y0 Imaginary part of the point.
+ * @param params Settings of the calculation.
+ * @param stats Statistics to be updated.
+ * @param p Result of the convergence test, updated when the test is resumed.
+ * @param state Where the test stopped: 0 iterations to start a new test.
+ */
+template<int Fields>
+void MandelbrotKernel::resumableGeneralTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                            MandelbrotKernelStats &stats, MandelbrotPoint &p, MandelbrotOrbitState &state)
+{
+    if(state.n == 0) {
+        state.nextSave = 1;
+        state.hasExited = false;
+        state.hasExitedDist = false;
+        state.zx = state.zy = 0;
+        state.dzx = 1;
+        state.dzy = 0;
+        state.zSavedx = state.zSavedy = 0;
+    }
+    if(state.n < 0) return;
+
+    // Only the parts of the result already reached by the orbit are kept.
+    if(!state.hasExited) {
+        p.n = -1;
+        p.r = 0;
+    }
+    if(!state.hasExitedDist) {
+        p.de = 0;
+    }
+
+    double rcut2 = 4;
+    int niterDist = 1000;
+    double rcutDist = 1000;
+    bool hasExitedDist = state.hasExitedDist;
+
+    Complex c(x0, y0);
+    Complex z(state.zx, state.zy);
+    Complex dz(state.dzx, state.dzy);
+    Complex one(1,0);
+    Complex zSaved(state.zSavedx, state.zSavedy);
+    int nextSave = state.nextSave;
+    bool hasExited = state.hasExited;
+    bool isComplete = false;
+    int i = state.n;
+    for(; i<params.precision; i++){
+        if(Fields & MandelbrotSet::DistanceField) {
+            dz = params.order * std::pow(z, params.order-1) * dz + one;
+        }
+        z = std::pow(z, params.order) + c;
+        double r2 = std::norm(z);
+        if(!hasExited && r2 > rcut2){
+            p.n = i;
+            if(Fields & MandelbrotSet::RadiusField) {
+                p.r = sqrt(r2);
+            }
+            hasExited = true;
+        }
+        if(Fields & MandelbrotSet::DistanceField) {
+            double dr = std::abs(dz);
+            if(!hasExitedDist && (i > niterDist || dr > rcutDist)) {
+                double r = sqrt(r2);
+                p.de = r * log(r)/dr;
+                hasExitedDist = true;
+            }
+        }
+        if(hasExited && (hasExitedDist || !(Fields & MandelbrotSet::DistanceField))){
+            isComplete = true;
+            break;
+        }
+        if(!hasExited) {
+            if(norm(z - zSaved) < params.periodicityTolerance2) {
+                stats.skippedIterations += params.precision - i - 1;
+                isComplete = true;
+                break;
+            }
+            if(i == nextSave) {
+                zSaved = z;
+                nextSave *= 2;
+            }
+        }
+    }
+
+    if(isComplete) {
+        state.n = -1;
+        return;
+    }
+    state.n = i;
+    state.nextSave = nextSave;
+    state.hasExited = hasExited;
+    state.hasExitedDist = hasExitedDist;
+    state.zx = z.real();
+    state.zy = z.imag();
+    state.dzx = dz.real();
+    state.dzy = dz.imag();
+    state.zSavedx = zSaved.real();
+    state.zSavedy = zSaved.imag();
+}
+
+/**
+ * Same algorithm as integerTest<2>() where the orbit is iterated in
+ * double-double precision. The derivative, the escape radius and the
+ * distance estimate only need the high parts, and are computed as doubles.
+ * Points inside the main bulbs are not classified beforehand: at the zoom
+ * levels where this test is used, the check would not be accurate enough.
+ *
+ * @param x0 Real part of the point.
+ * @param y0 Imaginary part of the point.
+ * @param params Settings of the calculation.
+ * @param stats Statistics to be updated.
+ * @return The result of the convergence test.
+ */
+MandelbrotKernel::MandelbrotPoint MandelbrotKernel::doubleDoubleTest(const DoubleDouble &x0, const DoubleDouble &y0,
+                                                                     const MandelbrotKernelParams &params,
+                                                                     MandelbrotKernelStats &stats)
+{
+    MandelbrotPoint p;
+    p.n = -1;
+    p.r = 0;
+    p.de = 0;
+
+    const double rcut2 = 4;
+    const int niterDist = 1000;
+    const double rcutDist = 1000;
+    bool hasExitedDist = false;
+
+    DoubleDouble zx;
+    DoubleDouble zy;
+    DoubleDouble zSavedx;
+    DoubleDouble zSavedy;
+    Complex dz(1,0);
+    int nextSave = 1;
+    bool hasExited = false;
+    for(int i=0; i<params.precision; i++){
+        dz = multiply(2. * Complex(zx.hi, zy.hi), dz) + 1.;
+        DoubleDouble xy = zx * zy;
+        zx = zx * zx - zy * zy + x0;
+        zy = xy.twice() + y0;
+        double r2 = zx.hi * zx.hi + zy.hi * zy.hi;
+        if(!hasExited && r2 > rcut2){
+            p.n = i;
+            p.r = sqrt(r2);
+            hasExited = true;
+        }
+        double dr2 = norm(dz);
+        if(!hasExitedDist && (i > niterDist || dr2 > rcutDist * rcutDist)) {
+            double r = sqrt(r2);
+            p.de = r * log(r)/sqrt(dr2);
+            hasExitedDist = true;
+        }
+        if(hasExited && hasExitedDist){
+            break;
+        }
+        if(!hasExited) {
+            double dx = (zx - zSavedx).hi;
+            double dy = (zy - zSavedy).hi;
+            if(dx * dx + dy * dy < params.periodicityTolerance2) {
+                stats.skippedIterations += params.precision - i - 1;
+                break;
+            }
+            if(i == nextSave) {
+                zSavedx = zx;
+                zSavedy = zy;
+                nextSave *= 2;
+            }
+        }
+    }
+    return p;
+}
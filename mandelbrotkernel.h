@@ -0,0 +1,300 @@
+#ifndef MANDELBROTKERNEL_H
+#define MANDELBROTKERNEL_H
+
+#include "mandelbrotset.h"
+#include "mandelbrotdoubledouble.h"
+
+#include <complex>
+#include <math.h>
+
+/**
+ * @brief The MandelbrotKernelParams structure.
+ *
+ * Settings shared by all the convergence tests of a calculation.
+ */
+struct MandelbrotKernelParams {
+    int precision; //!< Number of iterations before calling a convergence.
+    double order; //!< Order of the set.
+    double periodicityTolerance2; //!< Squared distance below which an orbit is considered periodic. 0 to disable.
+    int fields; //!< Fields of the results to be filled, as MandelbrotSet::PointField flags.
+};
+
+/**
+ * @brief The MandelbrotKernelStats structure.
+ *
+ * Statistics accumulated by the convergence tests.
+ */
+struct MandelbrotKernelStats {
+    qint64 skippedIterations; //!< Iterations saved by the periodicity checks.
+    qint64 approximatedIterations; //!< Iterations skipped by the series approximation of deep zooms.
+};
+
+/**
+ * @brief The MandelbrotPower structure.
+ *
+ * Raises a complex number to a compile-time integer power
+ * by repeated squaring.
+ */
+template<int N>
+struct MandelbrotPower {
+
+    /** Get z to the power N. */
+    static std::complex<double> power(const std::complex<double> &z);
+};
+
+/**
+ * @brief The MandelbrotKernel class.
+ *
+ * This class implements the convergence test of a single point.
+ *
+ * The general test relies on std::pow which handles any real order
+ * but goes through a complex logarithm and exponential at every iteration.
+ * For the integer orders 2 to 8, specialized tests are generated at
+ * compile-time where the powers are computed by complex multiplications only.
+ * The test to use is selected once per calculation with select().
+ *
+ * All the tests look for periodic orbits using Brent's algorithm:
+ * the orbit is saved at iterations that are powers of two and compared
+ * to the following iterations. When a point of the orbit comes back within
+ * the tolerance of the saved one, the orbit is locked into an attracting
+ * cycle and the point is declared converged without using the full precision.
+ *
+ * For zooms past the resolution of doubles, the order 2 test is also available
+ * in double-double precision (see MandelbrotDoubleDouble).
+ *
+ * The tests are generated for each set of MandelbrotSet::PointField flags.
+ * Without the distance estimate, the derivative of the orbit is not
+ * computed and the iterations stop as soon as the orbit escapes.
+ *
+ * The double precision tests can also be resumed: a point that runs out of
+ * iterations keeps its orbit in a MandelbrotOrbitState, from which the test
+ * carries on when the precision is raised. The results are the same as the
+ * ones of a test performed with the higher precision from the start.
+ */
+class MandelbrotKernel
+{
+public:
+
+    typedef std::complex<double> Complex;
+    typedef MandelbrotDoubleDouble<double> DoubleDouble;
+    typedef MandelbrotSet::MandelbrotPoint MandelbrotPoint;
+    typedef MandelbrotSet::MandelbrotOrbitState MandelbrotOrbitState;
+
+    /** Signature of a convergence test. */
+    typedef MandelbrotPoint (*ConvergenceTest)(double x0, double y0, const MandelbrotKernelParams &params,
+                                               MandelbrotKernelStats &stats);
+
+    /** Signature of a resumable convergence test. */
+    typedef void (*ResumableTest)(double x0, double y0, const MandelbrotKernelParams &params,
+                                  MandelbrotKernelStats &stats, MandelbrotPoint &p, MandelbrotOrbitState &state);
+
+    /** Select the fastest convergence test for a given order and the fields to be filled. */
+    static ConvergenceTest select(double order, int fields = MandelbrotSet::AllFields);
+
+    /** Select the fastest resumable convergence test for a given order and the fields to be filled. */
+    static ResumableTest selectResumable(double order, int fields = MandelbrotSet::AllFields);
+
+    /** Convergence test for any real order. */
+    template<int Fields>
+    static MandelbrotPoint generalTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                       MandelbrotKernelStats &stats);
+
+    /** Resumable convergence test for any real order. */
+    template<int Fields>
+    static void resumableGeneralTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                     MandelbrotKernelStats &stats, MandelbrotPoint &p, MandelbrotOrbitState &state);
+
+    /** Convergence test for a compile-time integer order. */
+    template<int Order, int Fields = MandelbrotSet::AllFields>
+    static MandelbrotPoint integerTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                       MandelbrotKernelStats &stats);
+
+    /** Resumable convergence test for a compile-time integer order. */
+    template<int Order, int Fields = MandelbrotSet::AllFields>
+    static void resumableIntegerTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                     MandelbrotKernelStats &stats, MandelbrotPoint &p, MandelbrotOrbitState &state);
+
+    /** Order 2 convergence test in double-double precision. */
+    static MandelbrotPoint doubleDoubleTest(const DoubleDouble &x0, const DoubleDouble &y0,
+                                            const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Check if a point lies in the main cardioid or in the period-2 bulb of the order 2 set. */
+    static inline bool isInMainBulbs(double x0, double y0)
+    {
+        double xq = x0 - 0.25;
+        double q = xq * xq + y0 * y0;
+        if(q * (q + xq) <= 0.25 * y0 * y0) return true;
+        double xb = x0 + 1;
+        return xb * xb + y0 * y0 <= 0.0625;
+    }
+
+    /** Multiply two complex numbers, without the inf/nan recovery of std::complex. */
+    static inline Complex multiply(const Complex &a, const Complex &b)
+    {
+        return Complex(a.real() * b.real() - a.imag() * b.imag(),
+                       a.real() * b.imag() + a.imag() * b.real());
+    }
+
+    /** Get the squared modulus of a complex number. */
+    static inline double norm(const Complex &a)
+    {
+        return a.real() * a.real() + a.imag() * a.imag();
+    }
+
+    /** Square a complex number. */
+    static inline Complex square(const Complex &a)
+    {
+        return Complex(a.real() * a.real() - a.imag() * a.imag(),
+                       2 * a.real() * a.imag());
+    }
+};
+
+template<int N>
+inline std::complex<double> MandelbrotPower<N>::power(const std::complex<double> &z)
+{
+    std::complex<double> half = MandelbrotKernel::square(MandelbrotPower<N/2>::power(z));
+    return N % 2 ? MandelbrotKernel::multiply(half, z) : half;
+}
+
+template<>
+inline std::complex<double> MandelbrotPower<1>::power(const std::complex<double> &z)
+{
+    return z;
+}
+
+/**
+ * @param x0 Real part of the point.
+ * @param y0 Imaginary part of the point.
+ * @param params Settings of the calculation.
+ * @param stats Statistics to be updated.
+ * @return The result of the convergence test.
+ */
+template<int Order, int Fields>
+MandelbrotKernel::MandelbrotPoint MandelbrotKernel::integerTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                                                MandelbrotKernelStats &stats)
+{
+    MandelbrotPoint p;
+    MandelbrotOrbitState state;
+    state.n = 0;
+    resumableIntegerTest<Order, Fields>(x0, y0, params, stats, p, state);
+    return p;
+}
+
+/**
+ * Same algorithm as generalTest() where
+ * \f$z^{a-1}\f$ is computed once and reused to get \f$z^a\f$.
+ * The derivative is compared through its squared norm, which gives the
+ * same results as the vectorized tests of MandelbrotSimdKernel.
+ *
+ * For the order 2, points in the main cardioid or in the period-2 bulb
+ * are known to converge: they are classified without iterating.
+ *
+ * @param x0 Real part of the point.
+ * @param y0 Imaginary part of the point.
+ * @param params Settings of the calculation.
+ * @param stats Statistics to be updated.
+ * @param p Result of the convergence test, updated when the test is resumed.
+ * @param state Where the test stopped: 0 iterations to start a new test.
+ */
+template<int Order, int Fields>
+MANDELBROT_ALWAYS_INLINE void MandelbrotKernel::resumableIntegerTest(double x0, double y0, const MandelbrotKernelParams &params,
+                                                                     MandelbrotKernelStats &stats, MandelbrotPoint &p,
+                                                                     MandelbrotOrbitState &state)
+{
+    if(state.n == 0) {
+        state.nextSave = 1;
+        state.hasExited = false;
+        state.hasExitedDist = false;
+        state.zx = state.zy = 0;
+        state.dzx = 1;
+        state.dzy = 0;
+        state.zSavedx = state.zSavedy = 0;
+
+        if(Order == 2 && isInMainBulbs(x0, y0)) {
+            p.n = -1;
+            p.r = 0;
+            p.de = 0;
+            state.n = -1;
+            return;
+        }
+    }
+    if(state.n < 0) return;
+
+    // Only the parts of the result already reached by the orbit are kept.
+    if(!state.hasExited) {
+        p.n = -1;
+        p.r = 0;
+    }
+    if(!state.hasExitedDist) {
+        p.de = 0;
+    }
+
+    const double rcut2 = 4;
+    const int niterDist = 1000;
+    const double rcutDist = 1000;
+    bool hasExitedDist = state.hasExitedDist;
+
+    Complex c(x0, y0);
+    Complex z(state.zx, state.zy);
+    Complex dz(state.dzx, state.dzy);
+    Complex zSaved(state.zSavedx, state.zSavedy);
+    int nextSave = state.nextSave;
+    bool hasExited = state.hasExited;
+    bool isComplete = false;
+    int i = state.n;
+    for(; i<params.precision; i++){
+        Complex zp = MandelbrotPower<Order-1>::power(z);
+        if(Fields & MandelbrotSet::DistanceField) {
+            dz = multiply(double(Order) * zp, dz) + 1.;
+        }
+        z = multiply(zp, z) + c;
+        double r2 = norm(z);
+        if(!hasExited && r2 > rcut2){
+            p.n = i;
+            if(Fields & MandelbrotSet::RadiusField) {
+                p.r = sqrt(r2);
+            }
+            hasExited = true;
+        }
+        if(Fields & MandelbrotSet::DistanceField) {
+            double dr2 = norm(dz);
+            if(!hasExitedDist && (i > niterDist || dr2 > rcutDist * rcutDist)) {
+                double r = sqrt(r2);
+                p.de = r * log(r)/sqrt(dr2);
+                hasExitedDist = true;
+            }
+        }
+        if(hasExited && (hasExitedDist || !(Fields & MandelbrotSet::DistanceField))){
+            isComplete = true;
+            break;
+        }
+        if(!hasExited) {
+            if(norm(z - zSaved) < params.periodicityTolerance2) {
+                stats.skippedIterations += params.precision - i - 1;
+                isComplete = true;
+                break;
+            }
+            if(i == nextSave) {
+                zSaved = z;
+                nextSave *= 2;
+            }
+        }
+    }
+
+    if(isComplete) {
+        state.n = -1;
+        return;
+    }
+    state.n = i;
+    state.nextSave = nextSave;
+    state.hasExited = hasExited;
+    state.hasExitedDist = hasExitedDist;
+    state.zx = z.real();
+    state.zy = z.imag();
+    state.dzx = dz.real();
+    state.dzy = dz.imag();
+    state.zSavedx = zSaved.real();
+    state.zSavedy = zSaved.imag();
+}
+
+#endif // MANDELBROTKERNEL_H
@@ -0,0 +1,216 @@
+#include "mandelbrotperturbation.h"
+
+#include <algorithm>
+
+MandelbrotPerturbation::MandelbrotPerturbation()
+{
+    m_seriesLength = 0;
+    m_series[DzOrder0] = Complex(1, 0);
+}
+
+/**
+ * The orbit is iterated with the precision of the given point
+ * until it escapes or until the precision of the set is reached.
+ *
+ * @param x0 Real part of the reference point.
+ * @param y0 Imaginary part of the reference point.
+ * @param precision Number of iterations before calling a convergence.
+ * @param canceled Flag stopping the orbit early when set, null if the orbit cannot be canceled.
+ */
+void MandelbrotPerturbation::computeReferenceOrbit(const MandelbrotBigFloat &x0, const MandelbrotBigFloat &y0, int precision,
+                                                   const QAtomicInt *canceled)
+{
+    m_orbit.clear();
+    m_seriesLength = 0;
+    std::fill(m_series, m_series + s_nCoefs, Complex(0, 0));
+    m_series[DzOrder0] = Complex(1, 0);
+    m_orbit.reserve(precision + 1);
+    m_orbit.push_back(Complex(0, 0));
+
+    MandelbrotBigFloat zx;
+    MandelbrotBigFloat zy;
+    for(int i=0; i<precision; i++) {
+        if(canceled && i % s_cancelCheckInterval == 0 && canceled->load()) break;
+
+        MandelbrotBigFloat x2 = zx * zx;
+        MandelbrotBigFloat y2 = zy * zy;
+        MandelbrotBigFloat xy = zx * zy;
+        zx = x2 - y2 + x0;
+        zy = xy + xy + y0;
+
+        Complex z(zx.toDouble(), zy.toDouble());
+        m_orbit.push_back(z);
+        if(MandelbrotKernel::norm(z) > 4) break;
+    }
+}
+
+/**
+ * The coefficients follow from \f$\delta_{n+1} = 2 Z_n \delta_n + \delta_n^2 + \delta c\f$:
+ * \f{
+ * A_{n+1} = 2 Z_n A_n + 1
+ * B_{n+1} = 2 Z_n B_n + A_n^2
+ * C_{n+1} = 2 Z_n C_n + 2 A_n B_n
+ * \f}
+ * The derivative used by the distance estimate is expanded the same way,
+ * to the second order.
+ *
+ * The four corners of the image are iterated alongside. The series stops
+ * as soon as it misses one of them by more than a thousandth of a pixel,
+ * the error being scaled by \f$|A_n|\f$ which is how much the offsets have
+ * been stretched so far. It also stops before any corner escapes or needs
+ * to be rebased.
+ *
+ * @param width Width of the image in the complex plane.
+ * @param height Height of the image in the complex plane.
+ * @param pixelSpacing Distance between two pixels.
+ */
+void MandelbrotPerturbation::computeSeries(double width, double height, double pixelSpacing)
+{
+    const int nProbes = 4;
+    Complex probeDc[nProbes] = {
+        Complex(-width / 2, -height / 2), Complex(width / 2, -height / 2),
+        Complex(-width / 2, height / 2), Complex(width / 2, height / 2)
+    };
+    Complex probeDelta[nProbes];
+    Complex probeDz[nProbes];
+    for(int k=0; k<nProbes; k++) {
+        probeDz[k] = Complex(1, 0);
+    }
+
+    double tolerance = pixelSpacing * 1e-3;
+    Complex coefs[s_nCoefs];
+    coefs[DzOrder0] = Complex(1, 0);
+    m_seriesLength = 0;
+    std::copy(coefs, coefs + s_nCoefs, m_series);
+
+    int last = m_orbit.size() - 1;
+    for(int n=0; n<last-1; n++) {
+        Complex twoZ = 2. * m_orbit[n];
+        Complex next[s_nCoefs];
+        next[Order1] = MandelbrotKernel::multiply(twoZ, coefs[Order1]) + 1.;
+        next[Order2] = MandelbrotKernel::multiply(twoZ, coefs[Order2]) + MandelbrotKernel::square(coefs[Order1]);
+        next[Order3] = MandelbrotKernel::multiply(twoZ, coefs[Order3]) +
+                2. * MandelbrotKernel::multiply(coefs[Order1], coefs[Order2]);
+        next[DzOrder0] = MandelbrotKernel::multiply(twoZ, coefs[DzOrder0]) + 1.;
+        next[DzOrder1] = MandelbrotKernel::multiply(twoZ, coefs[DzOrder1]) +
+                2. * MandelbrotKernel::multiply(coefs[Order1], coefs[DzOrder0]);
+        next[DzOrder2] = MandelbrotKernel::multiply(twoZ, coefs[DzOrder2]) +
+                2. * MandelbrotKernel::multiply(coefs[Order1], coefs[DzOrder1]) +
+                2. * MandelbrotKernel::multiply(coefs[Order2], coefs[DzOrder0]);
+
+        double maxError2 = tolerance * tolerance * MandelbrotKernel::norm(next[Order1]);
+        bool isValid = std::isfinite(maxError2);
+        for(int k=0; k<s_nCoefs; k++) {
+            isValid = isValid && std::isfinite(MandelbrotKernel::norm(next[k]));
+        }
+        for(int k=0; k<nProbes && isValid; k++) {
+            probeDz[k] = MandelbrotKernel::multiply(twoZ + 2. * probeDelta[k], probeDz[k]) + 1.;
+            probeDelta[k] = MandelbrotKernel::multiply(twoZ + probeDelta[k], probeDelta[k]) + probeDc[k];
+            Complex z = m_orbit[n+1] + probeDelta[k];
+            Complex delta;
+            Complex dz;
+            evaluate(next, probeDc[k], delta, dz);
+            isValid = MandelbrotKernel::norm(delta - probeDelta[k]) <= maxError2 &&
+                    MandelbrotKernel::norm(dz - probeDz[k]) <= 1e-6 * MandelbrotKernel::norm(probeDz[k]) &&
+                    MandelbrotKernel::norm(z) <= 4 &&
+                    MandelbrotKernel::norm(z) >= MandelbrotKernel::norm(probeDelta[k]);
+        }
+        if(!isValid) break;
+
+        std::copy(next, next + s_nCoefs, coefs);
+        std::copy(coefs, coefs + s_nCoefs, m_series);
+        m_seriesLength = n + 1;
+    }
+}
+
+/**
+ * @param coefs Coefficients of the series.
+ * @param dc Offset of the point from the reference.
+ * @param delta Receives the approximated offset of the orbit.
+ * @param dz Receives the approximated derivative.
+ */
+void MandelbrotPerturbation::evaluate(const Complex *coefs, const Complex &dc, Complex &delta, Complex &dz)
+{
+    Complex dc2 = MandelbrotKernel::square(dc);
+    delta = MandelbrotKernel::multiply(coefs[Order1], dc) + MandelbrotKernel::multiply(coefs[Order2], dc2) +
+            MandelbrotKernel::multiply(coefs[Order3], MandelbrotKernel::multiply(dc2, dc));
+    dz = coefs[DzOrder0] + MandelbrotKernel::multiply(coefs[DzOrder1], dc) +
+            MandelbrotKernel::multiply(coefs[DzOrder2], dc2);
+}
+
+int MandelbrotPerturbation::getReferenceLength() const
+{
+    return m_orbit.size();
+}
+
+int MandelbrotPerturbation::getSeriesLength() const
+{
+    return m_seriesLength;
+}
+
+/**
+ * Gives the same MandelbrotPoint fields as MandelbrotKernel::integerTest<2>(),
+ * the derivative being iterated on the full orbit \f$Z_n + \delta_n\f$.
+ * Both the offset and the derivative start from the series approximation,
+ * if any: a distance estimate due during the skipped iterations is taken
+ * right after them.
+ *
+ * @param dx0 Real part of the offset of the point from the reference.
+ * @param dy0 Imaginary part of the offset of the point from the reference.
+ * @param params Settings of the calculation.
+ * @param stats Statistics to be updated.
+ * @return The result of the convergence test.
+ */
+MandelbrotPerturbation::MandelbrotPoint MandelbrotPerturbation::test(double dx0, double dy0,
+                                                                     const MandelbrotKernelParams &params,
+                                                                     MandelbrotKernelStats &stats) const
+{
+    MandelbrotPoint p;
+    p.n = -1;
+    p.r = 0;
+    p.de = 0;
+
+    const double rcut2 = 4;
+    const int niterDist = 1000;
+    const double rcutDist = 1000;
+    bool hasExitedDist = false;
+
+    Complex dc(dx0, dy0);
+    Complex delta;
+    Complex dz;
+    evaluate(m_series, dc, delta, dz);
+    stats.approximatedIterations += m_seriesLength;
+
+    int m = m_seriesLength;
+    int last = m_orbit.size() - 1;
+    bool hasExited = false;
+    for(int i=m_seriesLength; i<params.precision; i++){
+        Complex z = m_orbit[m] + delta;
+        dz = MandelbrotKernel::multiply(2. * z, dz) + 1.;
+        delta = MandelbrotKernel::multiply(2. * m_orbit[m] + delta, delta) + dc;
+        m++;
+        z = m_orbit[m] + delta;
+
+        double r2 = MandelbrotKernel::norm(z);
+        if(!hasExited && r2 > rcut2){
+            p.n = i;
+            p.r = sqrt(r2);
+            hasExited = true;
+        }
+        double dr2 = MandelbrotKernel::norm(dz);
+        if(!hasExitedDist && (i > niterDist || dr2 > rcutDist * rcutDist)) {
+            double r = sqrt(r2);
+            p.de = r * log(r)/sqrt(dr2);
+            hasExitedDist = true;
+        }
+        if(hasExited && hasExitedDist){
+            break;
+        }
+
+        if(m == last || r2 < MandelbrotKernel::norm(delta)) {
+            delta = z;
+            m = 0;
+        }
+    }
+    return p;
+}
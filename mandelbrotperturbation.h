@@ -0,0 +1,93 @@
+#ifndef MANDELBROTPERTURBATION_H
+#define MANDELBROTPERTURBATION_H
+
+#include "mandelbrotkernel.h"
+#include "mandelbrotbigfloat.h"
+
+#include <vector>
+
+/**
+ * @brief The MandelbrotPerturbation class.
+ *
+ * This class implements the convergence test of the order 2 set for deep zooms,
+ * where the pixels of an image can no longer be told apart as doubles.
+ *
+ * A single reference orbit \f$Z_n\f$ is computed at the center of the image
+ * using MandelbrotBigFloat, then rounded to doubles. Every pixel
+ * \f$c = C + \delta c\f$ is iterated as a small offset from the reference:
+ * \f{
+ * \delta_{n+1} = (2 Z_n + \delta_n) \delta_n + \delta c
+ * \f}
+ * which only involves doubles of the size of the pixel offsets.
+ *
+ * When the reference escapes, or when the orbit of a pixel gets closer to 0
+ * than to the reference (which is where the offsets lose their accuracy),
+ * the offset is rebased onto the start of the reference orbit.
+ * This keeps a single reference valid for every pixel of the image.
+ *
+ * Deep in the set, all the pixels follow the reference for a long while.
+ * The offsets are then approximated by a truncated series in \f$\delta c\f$:
+ * \f{
+ * \delta_n \approx A_n \delta c + B_n \delta c^2 + C_n \delta c^3
+ * \f}
+ * whose coefficients are iterated once along the reference orbit.
+ * Every pixel starts iterating where the series stops being accurate,
+ * which is checked against exact iterations of the corners of the image.
+ *
+ * The periodicity checks and the main bulbs shortcut are not used:
+ * both rely on absolute coordinates which are not accurate at these scales.
+ */
+class MandelbrotPerturbation
+{
+public:
+
+    typedef std::complex<double> Complex;
+    typedef MandelbrotSet::MandelbrotPoint MandelbrotPoint;
+
+    /** Constructor */
+    MandelbrotPerturbation();
+
+    /** Compute the reference orbit. */
+    void computeReferenceOrbit(const MandelbrotBigFloat &x0, const MandelbrotBigFloat &y0, int precision,
+                               const QAtomicInt *canceled = 0);
+
+    /** Compute the series approximating the offsets of the pixels of an image. */
+    void computeSeries(double width, double height, double pixelSpacing);
+
+    /** Get the number of points in the reference orbit. */
+    int getReferenceLength() const;
+
+    /** Get the number of iterations skipped by the series approximation. */
+    int getSeriesLength() const;
+
+    /** Convergence test of a point given as an offset from the reference. */
+    MandelbrotPoint test(double dx0, double dy0, const MandelbrotKernelParams &params, MandelbrotKernelStats &stats) const;
+
+protected:
+
+    /**
+     * @brief The SeriesCoef enum
+     *
+     * Coefficients of the series approximation.
+     */
+    enum SeriesCoef {
+        Order1,     //!< First order coefficient of the offset.
+        Order2,     //!< Second order coefficient of the offset.
+        Order3,     //!< Third order coefficient of the offset.
+        DzOrder0,   //!< Constant term of the derivative.
+        DzOrder1,   //!< First order coefficient of the derivative.
+        DzOrder2    //!< Second order coefficient of the derivative.
+    };
+
+    /** Evaluate the series for a given offset. */
+    static void evaluate(const Complex *coefs, const Complex &dc, Complex &delta, Complex &dz);
+
+    static const int s_nCoefs = DzOrder2 + 1; //!< Number of coefficients of the series approximation.
+    static const int s_cancelCheckInterval = 256; //!< Iterations of the reference orbit between two checks of the cancel flag.
+
+    std::vector<Complex> m_orbit; //!< Reference orbit rounded to doubles, starting at 0.
+    int m_seriesLength; //!< Number of iterations skipped by the series approximation.
+    Complex m_series[s_nCoefs]; //!< Coefficients of the series after the skipped iterations.
+};
+
+#endif // MANDELBROTPERTURBATION_H
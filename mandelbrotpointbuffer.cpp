@@ -0,0 +1,47 @@
+#include "mandelbrotpointbuffer.h"
+
+MandelbrotPointBuffer::MandelbrotPointBuffer()
+{
+}
+
+/**
+ * The arrays of the fields that are not kept are released.
+ *
+ * @param size Number of points.
+ * @param hasRadius Holds whether the radius of the points is kept.
+ * @param hasDistance Holds whether the distance estimate of the points is kept.
+ */
+void MandelbrotPointBuffer::resize(int size, bool hasRadius, bool hasDistance)
+{
+    m_n.resize(size);
+    if(hasRadius) {
+        m_r.resize(size);
+    }else{
+        std::vector<float>().swap(m_r);
+    }
+    if(hasDistance) {
+        m_de.resize(size);
+    }else{
+        std::vector<float>().swap(m_de);
+    }
+}
+
+/**
+ * @param other Buffer receiving the points of this one.
+ */
+void MandelbrotPointBuffer::swap(MandelbrotPointBuffer &other)
+{
+    m_n.swap(other.m_n);
+    m_r.swap(other.m_r);
+    m_de.swap(other.m_de);
+}
+
+/**
+ * @return The size in bytes of the arrays of the buffer.
+ */
+qint64 MandelbrotPointBuffer::getMemorySize() const
+{
+    return (qint64)m_n.capacity() * sizeof(qint32) +
+            (qint64)m_r.capacity() * sizeof(float) +
+            (qint64)m_de.capacity() * sizeof(float);
+}
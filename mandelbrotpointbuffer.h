@@ -0,0 +1,85 @@
+#ifndef MANDELBROTPOINTBUFFER_H
+#define MANDELBROTPOINTBUFFER_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+/**
+ * @brief The MandelbrotPoint structure.
+ *
+ * This structure holds information about the convergence/divergence
+ * of a point in the complex plane.
+ */
+struct MandelbrotPoint {
+    int n; //!< Number of iteration before divergence. -1 in case of convergence.
+    double r; //!< Radius of the first point in the series larger than 2.
+    double de; //!< Estimate of the distance to the boundary of the set.
+};
+
+/**
+ * @brief The MandelbrotPointBuffer class.
+ *
+ * Holds the results of the convergence tests of an image in a compact form.
+ *
+ * A MandelbrotPoint takes 24 bytes, padding included. Here each field is
+ * stored in its own array: the escape times as 32-bit integers, the radius
+ * and the distance estimate as floats, and the arrays of the fields that
+ * are not used are left out. A pixel takes from 4 bytes, for the themes
+ * that only use the escape time, to 12 bytes when every field is kept.
+ * The points are converted to MandelbrotPoint when they are read.
+ */
+class MandelbrotPointBuffer
+{
+public:
+
+    /** Constructor: an empty buffer. */
+    MandelbrotPointBuffer();
+
+    /** Set the number of points and the fields kept. */
+    void resize(int size, bool hasRadius, bool hasDistance);
+
+    /** Exchange the points of two buffers. */
+    void swap(MandelbrotPointBuffer &other);
+
+    /** Get the number of points. */
+    int size() const { return m_n.size(); }
+
+    /** Check if the buffer holds no points. */
+    bool empty() const { return m_n.empty(); }
+
+    /** Get the number of bytes allocated by the buffer. */
+    qint64 getMemorySize() const;
+
+    /** Get the escape time of a point. */
+    int getN(int k) const { return m_n[k]; }
+
+    /** Get a point, the fields that are not kept being 0. */
+    MandelbrotPoint get(int k) const
+    {
+        MandelbrotPoint p;
+        p.n = m_n[k];
+        p.r = m_r.empty() ? 0 : m_r[k];
+        p.de = m_de.empty() ? 0 : m_de[k];
+        return p;
+    }
+
+    /** Set a point, the fields that are not kept being dropped. */
+    void set(int k, const MandelbrotPoint &p)
+    {
+        m_n[k] = p.n;
+        if(!m_r.empty()) m_r[k] = p.r;
+        if(!m_de.empty()) m_de[k] = p.de;
+    }
+
+    /** Copy a point from another buffer. */
+    void copy(int k, const MandelbrotPointBuffer &other, int l) { set(k, other.get(l)); }
+
+protected:
+
+    std::vector<qint32> m_n; //!< Escape times.
+    std::vector<float> m_r; //!< Radii, empty if they are not kept.
+    std::vector<float> m_de; //!< Distance estimates, empty if they are not kept.
+};
+
+#endif // MANDELBROTPOINTBUFFER_H
@@ -0,0 +1,219 @@
+#include "mandelbrotrenderengine.h"
+#include "mandelbrotthememanager.h"
+
+#include <QColor>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+/**
+ * @param parent Parent object. Default is 0.
+ */
+MandelbrotRenderEngine::MandelbrotRenderEngine(QObject *parent) :
+    QObject(parent)
+{
+    m_mandelbrotSet = new MandelbrotSet();
+    m_order = m_mandelbrotSet->getOrder();
+    m_precision = m_mandelbrotSet->getPrecision();
+    m_isResumable = m_mandelbrotSet->isResumable();
+    m_hasJob = false;
+    m_isRendering = false;
+
+    qRegisterMetaType<MandelbrotViewport>("MandelbrotViewport");
+    qRegisterMetaType<MandelbrotRenderResult>("MandelbrotRenderResult");
+    connect(m_mandelbrotSet, SIGNAL(partialImageReady(QImage,MandelbrotViewport)),
+            this, SIGNAL(partialImageReady(QImage,MandelbrotViewport)));
+    connect(m_mandelbrotSet, SIGNAL(tilesReady()), this, SIGNAL(tilesReady()));
+}
+
+MandelbrotRenderEngine::~MandelbrotRenderEngine()
+{
+    cancel();
+    waitForDone();
+    delete m_mandelbrotSet;
+}
+
+MandelbrotSet *MandelbrotRenderEngine::getMandelbrotSet()
+{
+    return m_mandelbrotSet;
+}
+
+/**
+ * @param order Order of the set.
+ */
+void MandelbrotRenderEngine::setOrder(double order)
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_order = order;
+}
+
+/**
+ * @param precision Maximum number of iterations.
+ */
+void MandelbrotRenderEngine::setPrecision(int precision)
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_precision = precision;
+}
+
+/**
+ * @param isResumable true to keep the orbits.
+ */
+void MandelbrotRenderEngine::setResumable(bool isResumable)
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_isResumable = isResumable;
+}
+
+/**
+ * @param viewport Region of the complex plane to be rendered.
+ * @param size Size of the image in pixels.
+ * @param focus Point computed first, as fractions of the size of the image. Default is the center.
+ * @return A job rendering the region with the settings set last and the current theme.
+ */
+MandelbrotRenderJob MandelbrotRenderEngine::makeJob(const MandelbrotViewport &viewport, const QSize &size,
+                                                    const QPointF &focus)
+{
+    QMutexLocker locker(&m_jobMutex);
+    MandelbrotRenderJob job;
+    job.viewport = viewport;
+    job.size = size;
+    job.order = m_order;
+    job.precision = m_precision;
+    job.isResumable = m_isResumable;
+    job.focus = focus;
+    job.isFastPreview = false;
+    job.themeInfo = m_mandelbrotSet->getThemeManager()->getCurrentThemeInfo();
+    return job;
+}
+
+/**
+ * The call does not block: the job is rendered in the rendering thread,
+ * which is started if needed. The job replaces the one waiting, if any,
+ * and cancels the calculation in progress.
+ *
+ * @param job Job to be rendered.
+ */
+void MandelbrotRenderEngine::render(const MandelbrotRenderJob &job)
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_job = job;
+    m_hasJob = true;
+    if(m_isRendering) {
+        m_mandelbrotSet->cancel();
+    }else{
+        m_isRendering = true;
+        m_future = QtConcurrent::run(this, &MandelbrotRenderEngine::renderJobs);
+    }
+}
+
+/**
+ * @param viewport Region of the complex plane to be rendered.
+ * @param size Size of the image in pixels.
+ * @param focus Point computed first, as fractions of the size of the image. Default is the center.
+ */
+void MandelbrotRenderEngine::render(const MandelbrotViewport &viewport, const QSize &size, const QPointF &focus)
+{
+    render(makeJob(viewport, size, focus));
+}
+
+void MandelbrotRenderEngine::cancel()
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_hasJob = false;
+    m_mandelbrotSet->cancel();
+}
+
+/**
+ * The rendering thread stops once no job is left, so jobs
+ * submitted meanwhile are waited for as well.
+ */
+void MandelbrotRenderEngine::waitForDone()
+{
+    m_jobMutex.lock();
+    QFuture<void> future = m_future;
+    m_jobMutex.unlock();
+    future.waitForFinished();
+}
+
+/**
+ * The cancel flag of the set is only cleared when a job is taken, under the
+ * same lock as render(): a cancel meant for the job about to start cannot be lost.
+ *
+ * A job rendered as a fast preview is queued again at full precision.
+ */
+void MandelbrotRenderEngine::renderJobs()
+{
+    forever {
+        MandelbrotRenderJob job;
+        {
+            QMutexLocker locker(&m_jobMutex);
+            if(!m_hasJob) {
+                m_isRendering = false;
+                return;
+            }
+            job = m_job;
+            m_hasJob = false;
+            m_mandelbrotSet->resetCancel();
+        }
+
+        // Changing the settings discards the buffers of the set, keep them when possible.
+        if(job.order != m_mandelbrotSet->getOrder()) {
+            m_mandelbrotSet->setOrder(job.order);
+        }
+        if(job.precision != m_mandelbrotSet->getPrecision()) {
+            m_mandelbrotSet->setPrecision(job.precision);
+        }
+        if(job.isResumable != m_mandelbrotSet->isResumable()) {
+            m_mandelbrotSet->setResumable(job.isResumable);
+        }
+        if(job.isFastPreview != m_mandelbrotSet->isFastPreview()) {
+            m_mandelbrotSet->setFastPreview(job.isFastPreview);
+        }
+        m_mandelbrotSet->setFocus(job.focus.x(), job.focus.y());
+        m_mandelbrotSet->setThemeInfo(job.themeInfo);
+
+        QImage image(job.size, QImage::Format_RGB32);
+        image.fill(QColor(0, 0, 0));
+
+        if(m_mandelbrotSet->fillPixmap(image, job.viewport)) {
+            if(job.isFastPreview && m_mandelbrotSet->isPreview()) {
+                // Follow the preview with the full precision image, unless a newer job came first.
+                m_jobMutex.lock();
+                if(!m_hasJob) {
+                    m_job = job;
+                    m_job.isFastPreview = false;
+                    m_hasJob = true;
+                }
+                m_jobMutex.unlock();
+                emit(partialImageReady(image, job.viewport));
+            }else{
+                emit(imageReady(image, makeResult(job.viewport)));
+            }
+        }else{
+            // A newer job takes over with its own images.
+            m_jobMutex.lock();
+            bool isReplaced = m_hasJob;
+            m_jobMutex.unlock();
+            if(!isReplaced) {
+                emit(renderCanceled());
+            }
+        }
+    }
+}
+
+/**
+ * @param viewport Region of the complex plane shown by the image.
+ * @return A copy of the state of the set describing the image.
+ */
+MandelbrotRenderResult MandelbrotRenderEngine::makeResult(const MandelbrotViewport &viewport) const
+{
+    MandelbrotRenderResult result;
+    result.viewport = viewport;
+    result.precisionTier = m_mandelbrotSet->getPrecisionTier();
+    result.precisionTierReason = m_mandelbrotSet->getPrecisionTierReason();
+    result.skippedIterations = m_mandelbrotSet->getSkippedIterations();
+    result.approximatedIterations = m_mandelbrotSet->getApproximatedIterations();
+    result.bytesPerPixel = m_mandelbrotSet->getBytesPerPixel();
+    result.workerStats = m_mandelbrotSet->getWorkerStats();
+    return result;
+}
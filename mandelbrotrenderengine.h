@@ -0,0 +1,150 @@
+#ifndef MANDELBROTRENDERENGINE_H
+#define MANDELBROTRENDERENGINE_H
+
+#include <QObject>
+#include <QImage>
+#include <QSize>
+#include <QPointF>
+#include <QMutex>
+#include <QFuture>
+#include <QString>
+#include <QMetaType>
+
+#include <vector>
+
+#include "mandelbrotset.h"
+#include "mandelbrotviewport.h"
+#include "mandelbrotthemeinfo.h"
+#include "mandelbrottilescheduler.h"
+
+/**
+ * @brief The MandelbrotRenderJob structure.
+ *
+ * Everything needed to render an image, copied when the job is submitted
+ * so that the settings can change while it is being rendered.
+ */
+struct MandelbrotRenderJob {
+    MandelbrotViewport viewport; //!< Region of the complex plane to be rendered.
+    QSize size; //!< Size of the image in pixels.
+    double order; //!< Order of the set.
+    int precision; //!< Maximum number of iterations.
+    bool isResumable; //!< Holds whether the orbits running out of iterations are kept.
+    QPointF focus; //!< Point computed first, as fractions of the size of the image from the top left corner.
+    bool isFastPreview; //!< Holds whether deep zooms may be previewed with a faster, less precise arithmetic.
+    MandelbrotThemeInfo themeInfo; //!< Theme colorizing the image, which also selects the rendering method.
+};
+
+/**
+ * @brief The MandelbrotRenderResult structure.
+ *
+ * What is known about a complete image, copied in the rendering thread
+ * so that it can be read while the set renders the next job.
+ */
+struct MandelbrotRenderResult {
+    MandelbrotViewport viewport; //!< Region of the complex plane shown by the image.
+    MandelbrotSet::PrecisionTier precisionTier; //!< Arithmetic used by the calculation.
+    QString precisionTierReason; //!< Reason why the arithmetic was selected.
+    qint64 skippedIterations; //!< Iterations saved by the periodicity checks.
+    qint64 approximatedIterations; //!< Iterations skipped by the series approximation.
+    double bytesPerPixel; //!< Memory used by the buffers of the set, per pixel.
+    std::vector<MandelbrotWorkerStats> workerStats; //!< Activity of each worker.
+};
+
+Q_DECLARE_METATYPE(MandelbrotRenderResult)
+
+/**
+ * @brief The MandelbrotRenderEngine class.
+ *
+ * Renders images of a MandelbrotSet in a separate thread, without touching
+ * any widget: the results are only delivered through signals, which are
+ * received in the thread of the engine. It can therefore be used without
+ * a GUI, and several engines, each with its own set, can run at once.
+ * The state of the set describing an image is sent along with it: the set
+ * itself may already be rendering the next job.
+ *
+ * The images are rendered one at a time. The latest job wins: it cancels
+ * the calculation in progress and replaces any job still waiting, so that
+ * rapid zooms never wait for images nobody will look at.
+ *
+ * The settings of the set that are not part of a MandelbrotRenderJob
+ * should not be changed while a job is rendered. The themes of the theme
+ * manager of the set can be: the current one is copied into each job.
+ */
+class MandelbrotRenderEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /** Constructor */
+    explicit MandelbrotRenderEngine(QObject *parent = 0);
+
+    /** Destructor: cancel the ongoing calculation and wait for it. */
+    ~MandelbrotRenderEngine();
+
+    /** Get the Mandelbrot set rendered by the engine. */
+    MandelbrotSet *getMandelbrotSet();
+
+    /** Set the order of the set for the next jobs. */
+    void setOrder(double order);
+
+    /** Set the maximum number of iterations for the next jobs. */
+    void setPrecision(int precision);
+
+    /** Set whether the next jobs keep the orbits running out of iterations. */
+    void setResumable(bool isResumable);
+
+    /** Make a job with the current settings and theme. */
+    MandelbrotRenderJob makeJob(const MandelbrotViewport &viewport, const QSize &size,
+                                const QPointF &focus = QPointF(0.5, 0.5));
+
+    /** Start rendering a job, replacing the ones not finished yet. */
+    void render(const MandelbrotRenderJob &job);
+
+    /** Start rendering a region with the current settings. */
+    void render(const MandelbrotViewport &viewport, const QSize &size,
+                const QPointF &focus = QPointF(0.5, 0.5));
+
+    /** Cancel the ongoing calculation and the job waiting, if any. */
+    void cancel();
+
+    /** Wait until no job is left. */
+    void waitForDone();
+
+signals:
+
+    /**
+     * Signal a coarse version of the image, available before the end of the calculation.
+     * Fast previews are signaled this way as well, the full precision image follows.
+     */
+    void partialImageReady(const QImage &image, const MandelbrotViewport &viewport);
+
+    /** Signal completed tiles, to be taken with MandelbrotSet::takeCompletedTiles(). */
+    void tilesReady();
+
+    /** Signal a complete image. */
+    void imageReady(const QImage &image, const MandelbrotRenderResult &result);
+
+    /** Signal a job canceled without being replaced by another one. */
+    void renderCanceled();
+
+protected:
+
+    /** Render the jobs until none is left, in the rendering thread. */
+    void renderJobs();
+
+    /** Describe the image just rendered by the set, in the rendering thread. */
+    MandelbrotRenderResult makeResult(const MandelbrotViewport &viewport) const;
+
+    MandelbrotSet *m_mandelbrotSet; //!< Set rendered, only used by the rendering thread while a job runs.
+    QMutex m_jobMutex; //!< Protects the members below.
+    double m_order; //!< Order of the set for the next jobs.
+    int m_precision; //!< Maximum number of iterations for the next jobs.
+    bool m_isResumable; //!< Holds whether the next jobs keep the orbits running out of iterations.
+    MandelbrotRenderJob m_job; //!< Job waiting to be rendered.
+    bool m_hasJob; //!< Holds whether a job is waiting.
+    bool m_isRendering; //!< Holds whether the rendering thread is running.
+    QFuture<void> m_future; //!< Rendering thread.
+};
+
+#endif // MANDELBROTRENDERENGINE_H
@@ -1,28 +1,186 @@
 #include "mandelbrotset.h"
 #include "mandelbrotthememanager.h"
+#include "mandelbrottheme.h"
+#include "mandelbrottilescheduler.h"
+#include "mandelbrotkernel.h"
+#include "mandelbrotsimdkernel.h"
+#include "mandelbrotperturbation.h"
 
-#include <complex>
+#include <algorithm>
 
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QtConcurrent>
 #include <QDebug>
 
-typedef std::complex<double> Complex;
+const int MandelbrotSet::s_passStrides[MandelbrotSet::s_nPasses] = {4, 2, 1};
+const double MandelbrotSet::s_reuseTolerance = 1e-6;
+const double MandelbrotSet::s_doubleResolution = 1e-13;
+const double MandelbrotSet::s_doubleDoubleResolution = 1e-28;
+const double MandelbrotSet::s_floatResolution = 1e-6;
+const double MandelbrotSet::s_floatZoomLimit = 1e4;
+const int MandelbrotSet::s_pixelOverhead = 10;
+
+/**
+ * @brief The MandelbrotSet::RenderJob structure.
+ *
+ * Holds everything the workers need to perform the convergence tests of an image.
+ */
+struct MandelbrotSet::RenderJob {
+    MandelbrotTileScheduler *scheduler; //!< Source of the tiles to be processed.
+    MandelbrotPointBuffer *buffer; //!< Buffer receiving the result of the convergence tests.
+    std::vector<char> *isComputed; //!< Flags the pixels of the buffer already computed by a previous pass.
+    int pass; //!< Index of the current pass.
+    int stride; //!< Spacing in pixels of the grid computed by the current pass.
+    int previousStride; //!< Spacing in pixels of the grid computed by the previous pass, 0 for the first pass.
+    int w; //!< Width of the image in pixels.
+    int h; //!< Height of the image in pixels.
+    double xmin; //!< Start of the x coordinate range in the complex plane.
+    double xmax; //!< End of the x coordinate range in the complex plane.
+    double ymin; //!< Start of the y coordinate range in the complex plane.
+    double ymax; //!< End of the y coordinate range in the complex plane.
+    double width; //!< Width of the region in the complex plane.
+    double height; //!< Height of the region in the complex plane.
+    MandelbrotPerturbation *perturbation; //!< Reference orbit for deep zooms, null otherwise.
+    bool isDoubleDouble; //!< Holds whether the points are computed in double-double precision.
+    MandelbrotKernel::DoubleDouble centerX; //!< Real part of the center of the region in double-double precision.
+    MandelbrotKernel::DoubleDouble centerY; //!< Imaginary part of the center of the region in double-double precision.
+    MandelbrotKernel::ConvergenceTest convergenceTest; //!< Convergence test selected for the order of the set.
+    MandelbrotKernel::ResumableTest resumableTest; //!< Resumable convergence test selected for the order of the set.
+    std::vector<MandelbrotOrbitState> *orbitStates; //!< Orbits of the pixels if they are kept, null otherwise.
+    MandelbrotSimdKernel::BatchTest batchTest; //!< Vectorized test if available for the order of the set, null otherwise.
+    MandelbrotSimdKernel::BatchTestDoubleDouble batchTestDoubleDouble; //!< Vectorized double-double test if used and available, null otherwise.
+    MandelbrotKernelParams params; //!< Settings of the convergence tests.
+    MandelbrotThemeInfo::RenderingMethod renderingMethod; //!< How the tiles are rendered.
+    const MandelbrotViewport *viewport; //!< Region of the complex plane mapped to the image.
+    bool isStreamingTiles; //!< Holds whether the tiles of the last pass are queued once complete.
+    std::vector<MandelbrotWorkerStats> *workerStats; //!< Activity of each worker.
+    int nTileRows; //!< Number of tiles in a column of the image.
+    std::vector<double> *tilePixelCosts; //!< Predicted cost of a pixel of each tile, measured by the first pass.
+    std::vector<int> *tilePendingPixels; //!< Pixels of each tile left to each pass, counted by the first pass.
+
+    /** Perform the convergence test of a pixel. */
+    MandelbrotPoint test(int i, int j, MandelbrotKernelStats &stats) const
+    {
+        if(perturbation) {
+            double dx = -width / 2 + i * width / w;
+            double dy = -height / 2 + (h-j-1) * height / h;
+            return perturbation->test(dx, dy, params, stats);
+        }
+        if(isDoubleDouble) {
+            MandelbrotKernel::DoubleDouble x;
+            MandelbrotKernel::DoubleDouble y;
+            getDoubleDoublePoint(i, j, x, y);
+            return MandelbrotKernel::doubleDoubleTest(x, y, params, stats);
+        }
+        double x = xmin + i * (xmax - xmin) / w;
+        double y = ymin + (h-j-1) * (ymax - ymin) / h;
+        if(batchTest) {
+            // Same arithmetic as the pixels computed in batches, single precision included.
+            MandelbrotPoint p;
+            batchTest(&x, &y, 1, &p, params, stats);
+            return p;
+        }
+        if(orbitStates) {
+            MandelbrotPoint p = buffer->get(i*h+j);
+            resumableTest(x, y, params, stats, p, (*orbitStates)[i*h+j]);
+            return p;
+        }
+        return convergenceTest(x, y, params, stats);
+    }
+
+    /** Perform the convergence test of a pixel, unless a previous pass did. */
+    MandelbrotPoint compute(int i, int j, MandelbrotKernelStats &stats) const
+    {
+        char &computed = (*isComputed)[i*h+j];
+        if(computed) {
+            return buffer->get(i*h+j);
+        }
+        MandelbrotPoint p = test(i, j, stats);
+        buffer->set(i*h+j, p);
+        computed = 1;
+        return p;
+    }
+
+    /** Check if a pixel belongs to the grid of the current pass and is still to be computed. */
+    bool isPending(int i, int j) const
+    {
+        return i % stride == 0 && j % stride == 0 && !(*isComputed)[i*h+j];
+    }
+
+    /** Get the index of a tile in the records of the tiles, from its position. */
+    int getTileIndex(const MandelbrotTile &tile) const
+    {
+        return (tile.x0 / s_tileSize) * nTileRows + tile.y0 / s_tileSize;
+    }
+
+    /** Get the number of pixels of a tile on the grid of the current pass but not of the previous one. */
+    int countPassPixels(const MandelbrotTile &tile) const
+    {
+        int n = countGridPixels(tile, stride);
+        if(previousStride > 0) n -= countGridPixels(tile, previousStride);
+        return n;
+    }
+
+    /** Get the number of pixels of a tile on a grid of a given spacing. */
+    static int countGridPixels(const MandelbrotTile &tile, int s)
+    {
+        int nx = (tile.x1 + s - 1) / s - (tile.x0 + s - 1) / s;
+        int ny = (tile.y1 + s - 1) / s - (tile.y0 + s - 1) / s;
+        return nx * ny;
+    }
+
+    /** Get the coordinates of a pixel in double-double precision. */
+    void getDoubleDoublePoint(int i, int j, MandelbrotKernel::DoubleDouble &x, MandelbrotKernel::DoubleDouble &y) const
+    {
+        x = centerX + (-width / 2 + i * width / w);
+        y = centerY + (-height / 2 + (h-j-1) * height / h);
+    }
+};
+
+/**
+ * @param x A number.
+ * @return The number rounded to double-double precision.
+ */
+static MandelbrotKernel::DoubleDouble toDoubleDouble(const MandelbrotBigFloat &x)
+{
+    double hi = x.toDouble();
+    double lo = (x - MandelbrotBigFloat(hi, x.getNFractionLimbs())).toDouble();
+    return MandelbrotKernel::DoubleDouble(hi, lo);
+}
 
 MandelbrotSet::MandelbrotSet()
 {
     m_order = 2;
     m_precision = 500;
+    m_width = 0;
+    m_height = 0;
     m_themeManager = new MandelbrotThemeManager();
+    m_theme = new MandelbrotTheme(m_themeManager->getCurrentThemeInfo());
+    m_threadPool = new QThreadPool();
+    m_threadPool->setMaxThreadCount(QThread::idealThreadCount());
     m_isBufferUpToDate = false;
-    m_canceled = false;
-
-    m_xmin = -2;
-    m_xmax = 2;
-    m_ymin = -2;
-    m_ymax = 2;
+    m_bufferRenderingMethod = MandelbrotThemeInfo::FullRendering;
+    m_canceled.store(0);
+    m_isFastPreview = false;
+    m_isPreview = false;
+    m_isResumable = false;
+    m_isTileStreaming = false;
+    m_focusX = 0.5;
+    m_focusY = 0.5;
+    m_isBufferResumable = false;
+    m_bufferPrecision = 0;
+    m_bufferFields = AllFields;
+    m_precisionTier = DoubleTier;
+    m_bufferPrecisionTier = DoubleTier;
 }
 
 MandelbrotSet::~MandelbrotSet()
 {
+    delete m_threadPool;
+    delete m_theme;
     delete m_themeManager;
 }
 
@@ -34,90 +192,349 @@ void MandelbrotSet::setPrecision(int precision)
     m_isBufferUpToDate = false;
 }
 
+/**
+ * The theme is copied: the themes of the theme manager can be edited
+ * while an image is computed with this one.
+ *
+ * @param themeInfo Settings of the theme.
+ */
+void MandelbrotSet::setThemeInfo(const MandelbrotThemeInfo &themeInfo)
+{
+    m_theme->setThemeInfo(themeInfo);
+}
+
+/**
+ * Previews are computed in single precision whenever it resolves the pixels,
+ * however deep the zoom. Otherwise, single precision is only used for zoom
+ * factors below s_floatZoomLimit, where it is accurate enough.
+ *
+ * The buffer is kept, to be reused or resumed, unless it holds a preview
+ * that the final images have to compute again.
+ *
+ * @param isFastPreview true for quick previews, false for the final images.
+ */
+void MandelbrotSet::setFastPreview(bool isFastPreview)
+{
+    m_isFastPreview = isFastPreview;
+    if(!isFastPreview && m_isPreview) {
+        m_isBufferUpToDate = false;
+    }
+}
+
 void MandelbrotSet::setOrder(double order)
 {
     if(m_order < 0) return;
 
     m_order = order;
     m_isBufferUpToDate = false;
+    m_isBufferResumable = false;
+}
+
+/**
+ * When the orbits are kept, raising the precision only performs the extra
+ * iterations of the points that ran out of iterations, instead of computing
+ * the whole image again. This needs 64 bytes per pixel, and the points are
+ * computed by the scalar double precision tests: the mode is meant for deep
+ * renders where the precision is raised step by step.
+ * Zooms past the resolution of doubles do not keep their orbits.
+ *
+ * Like the other settings, this must not be called during a calculation.
+ * The orbits are only released by the next calculation.
+ *
+ * @param isResumable true to keep the orbits.
+ */
+void MandelbrotSet::setResumable(bool isResumable)
+{
+    if(isResumable == m_isResumable) return;
+
+    m_isResumable = isResumable;
+    m_isBufferUpToDate = false;
+    m_isBufferResumable = false;
+}
+
+bool MandelbrotSet::isResumable() const
+{
+    return m_isResumable;
+}
+
+bool MandelbrotSet::isFastPreview() const
+{
+    return m_isFastPreview;
 }
 
+/**
+ * The queued tiles are taken with takeCompletedTiles(), which has to be called
+ * after each tilesReady() signal. The themes coloring a pixel from the whole
+ * image, like MandelbrotThemeInfo::Histogram, are not streamed.
+ *
+ * @param isTileStreaming true to queue the tiles.
+ */
+void MandelbrotSet::setTileStreaming(bool isTileStreaming)
+{
+    m_isTileStreaming = isTileStreaming;
+}
+
+/**
+ * The point is where the user looks: the center of the image by default,
+ * or the cursor. The result of the calculation does not depend on it.
+ *
+ * @param x Column of the point, as a fraction of the width of the image.
+ * @param y Row of the point, as a fraction of the height of the image, from the top.
+ */
+void MandelbrotSet::setFocus(double x, double y)
+{
+    m_focusX = x;
+    m_focusY = y;
+}
+
+/**
+ * @param image Image to be filled.
+ * @param xmin Start of the x coordinate range in the complex plane.
+ * @param xmax End of the x coordinate range in the complex plane.
+ * @param ymin Start of the y coordinate range in the complex plane.
+ * @param ymax End of the y coordinate range in the complex plane.
+ * @return false if the calculation was canceled.
+ */
 bool MandelbrotSet::fillPixmap(QImage &image, double xmin, double xmax, double ymin, double ymax)
 {
-    m_canceled = false;
+    return fillPixmap(image, MandelbrotViewport(xmin, xmax, ymin, ymax));
+}
 
+/**
+ * @param image Image to be filled.
+ * @param viewport Region of the complex plane mapped to the image.
+ * @return false if the calculation was canceled.
+ */
+bool MandelbrotSet::fillPixmap(QImage &image, const MandelbrotViewport &viewport)
+{
     int w = image.width();
     int h = image.height();
 
     bool isBufferUpToDate = m_isBufferUpToDate;
-    if( (w != m_width || h != m_height ||
-         xmin != m_xmin || xmax != m_xmax ||
-         ymin != m_ymin || ymax != m_ymax) ){
+    if(w != m_width || h != m_height || viewport != m_viewport) {
         isBufferUpToDate = false;
     }
 
-    std::vector<MandelbrotPoint> buffer = m_buffer;
+    // Filled buffers lack the per-pixel data needed by some themes.
+    MandelbrotThemeInfo::ThemeType themeType = m_theme->getThemeInfo().getThemeType();
+    MandelbrotThemeInfo::RenderingMethod renderingMethod = MandelbrotThemeInfo::FullRendering;
+    if(MandelbrotThemeInfo::isFillingAllowed(themeType)) {
+        renderingMethod = m_theme->getThemeInfo().getRenderingMethod();
+    }else if(m_bufferRenderingMethod != MandelbrotThemeInfo::FullRendering) {
+        isBufferUpToDate = false;
+    }
+
+    // The convergence tests only fill the fields used by the theme.
+    int fields = getRequiredFields(themeType);
+    bool hasBufferFields = (m_bufferFields & fields) == fields;
+    if(!hasBufferFields) {
+        isBufferUpToDate = false;
+    }
 
-    int progress = -1;
     if(!isBufferUpToDate) {
 
-        buffer.resize(w*h);
+        // The image is computed in the back buffers, the front ones keeping the last complete image.
+        // Only the fields used by the theme are stored.
+        MandelbrotPointBuffer &buffer = m_backBuffer;
+        std::vector<MandelbrotOrbitState> &orbitStates = m_backOrbitStates;
+        buffer.resize(w*h, fields & RadiusField, fields & DistanceField);
+        orbitStates.clear();
 
-        for(int i=0; i<w; i++){
-            for(int j=0; j<h; j++){
+        // The calling thread takes part in the calculation as worker 0.
+        int nWorkers = m_threadPool->maxThreadCount();
+        // The tiles are processed outwards from the focus, all workers starting next to it.
+        std::vector<MandelbrotTile> tiles = MandelbrotTileScheduler::makeTiles(w, h, s_tileSize);
+        MandelbrotTileScheduler::sortByDistance(tiles, m_focusX * w, m_focusY * h);
+        std::vector<char> isComputed(w*h, 0);
+        m_renderedPixels.store(0);
+        m_progress.store(-1);
 
-                if(m_canceled) {
-                    emit(progressChanged(0));
-                    return false;
-                }
+        RenderJob job;
+        job.buffer = &buffer;
+        job.isComputed = &isComputed;
+        job.w = w;
+        job.h = h;
+        job.xmin = viewport.getXmin();
+        job.xmax = viewport.getXmax();
+        job.ymin = viewport.getYmin();
+        job.ymax = viewport.getYmax();
+        job.width = viewport.getWidth();
+        job.height = viewport.getHeight();
+        job.convergenceTest = MandelbrotKernel::select(m_order, fields);
+        job.batchTest = MandelbrotSimdKernel::select(m_order);
+        job.params.precision = m_precision;
+        job.params.order = m_order;
+        job.params.fields = fields;
 
-                double x = xmin + i * (xmax - xmin) / w;
-                double y = ymin + (h-j-1) * (ymax - ymin) / h;
+        // Orbits coming back within a thousandth of a pixel are considered periodic.
+        double pixelSpacing = std::min(job.width / w, job.height / h);
+        job.params.periodicityTolerance2 = pixelSpacing * pixelSpacing * 1e-6;
+        m_skippedIterations.store(0);
+        m_approximatedIterations.store(0);
 
-                buffer[i*h+j] = doConvergenceTest(x, y);
-            }
+        MandelbrotPerturbation perturbation;
+        job.perturbation = 0;
+        job.isDoubleDouble = false;
+        job.batchTestDoubleDouble = 0;
+        m_precisionTier = selectPrecisionTier(viewport, pixelSpacing, m_precisionTierReason);
+        bool isPreview = m_isFastPreview && m_precisionTier == FloatTier && viewport.getZoomFactor() >= s_floatZoomLimit;
+        switch(m_precisionTier) {
+        case FloatTier:
+            job.batchTest = MandelbrotSimdKernel::selectFloat(m_order);
+            break;
+        case DoubleDoubleTier:
+            job.isDoubleDouble = true;
+            job.centerX = toDoubleDouble(viewport.getCenterX());
+            job.centerY = toDoubleDouble(viewport.getCenterY());
+            job.batchTest = 0;
+            job.batchTestDoubleDouble = MandelbrotSimdKernel::selectDoubleDouble(m_order);
+            break;
+        case PerturbationTier:
+            perturbation.computeReferenceOrbit(viewport.getCenterX(), viewport.getCenterY(), m_precision, &m_canceled);
+            perturbation.computeSeries(job.width, job.height, pixelSpacing);
+            job.perturbation = &perturbation;
+            job.batchTest = 0;
+            job.params.periodicityTolerance2 = 0;
+            break;
+        default:
+            break;
+        }
+
+        job.renderingMethod = renderingMethod;
+        if(job.renderingMethod == MandelbrotThemeInfo::NoRenderingMethod) {
+            job.renderingMethod = MandelbrotThemeInfo::FullRendering;
+        }
+
+        // The tiles of previous calculations not taken yet are dropped.
+        job.viewport = &viewport;
+        job.isStreamingTiles = m_isTileStreaming && themeType != MandelbrotThemeInfo::Histogram;
+        m_completedTiles.takeAll();
+        if(job.isStreamingTiles) {
+            m_theme->setMandelbrotSet(this);
+        }
 
-            int prog = 100*i/w;
-            if(prog!=progress){
-                progress = prog;
-                emit(progressChanged(progress));
+        // The orbits of the previous image are resumed when only the precision was raised,
+        // the points that were complete being kept as they are.
+        job.resumableTest = MandelbrotKernel::selectResumable(m_order, fields);
+        job.orbitStates = 0;
+        if(m_isResumable && m_precisionTier == DoubleTier) {
+            job.orbitStates = &orbitStates;
+            job.batchTest = 0;
+            bool isResuming = m_isBufferResumable && w == m_width && h == m_height && viewport == m_viewport &&
+                    m_precision >= m_bufferPrecision && job.renderingMethod == m_bufferRenderingMethod &&
+                    m_bufferFields == fields;
+            if(isResuming) {
+                buffer = m_buffer;
+                orbitStates = m_orbitStates;
+                for(int k=0; k<w*h; k++) {
+                    if(orbitStates[k].n < 0) isComputed[k] = 1;
+                }
+            }else{
+                MandelbrotOrbitState start;
+                start.n = 0;
+                orbitStates.assign(w*h, start);
             }
+        }else if(!m_isResumable) {
+            std::vector<MandelbrotOrbitState>().swap(orbitStates);
+            std::vector<MandelbrotOrbitState>().swap(m_orbitStates);
         }
-    }
 
-    emit(progressChanged(100));
+        // The previous image is reused when it was computed the same way,
+        // pixels filled by a shortcut being only valid for the same shortcut.
+        bool isBufferReusable = m_isBufferUpToDate && m_precisionTier == m_bufferPrecisionTier && hasBufferFields &&
+                (m_bufferRenderingMethod == MandelbrotThemeInfo::FullRendering ||
+                 m_bufferRenderingMethod == job.renderingMethod);
+        if(isBufferReusable) {
+            reuseBuffer(viewport, w, h, buffer, orbitStates, isComputed);
+        }
 
-    m_themeManager->getCurrentTheme().setMandelbrotSet(this);
+        MandelbrotWorkerStats noActivity = {0, 0, 0, 0};
+        std::vector<MandelbrotWorkerStats> workerStats(nWorkers, noActivity);
+        job.workerStats = &workerStats;
 
-    progress = -1;
-    for(int i=0; i<w; i++){
-        for(int j=0; j<h; j++){
+        std::vector<double> tilePixelCosts(tiles.size(), s_pixelOverhead);
+        std::vector<int> tilePendingPixels(tiles.size() * s_nPasses, 0);
+        job.nTileRows = (h + s_tileSize - 1) / s_tileSize;
+        job.tilePixelCosts = &tilePixelCosts;
+        job.tilePendingPixels = &tilePendingPixels;
 
-            if(m_canceled) {
-                emit(progressChanged(0));
-                return false;
+        // Each pass computes the pixels on a grid twice as fine as the previous one,
+        // and the image is delivered as soon as a coarse pass is done.
+        job.previousStride = 0;
+        for(int pass=0; pass<s_nPasses; pass++) {
+
+            // The first pass is a low resolution probe of the cost of the next ones:
+            // the workers are then handed shares of equal predicted cost.
+            job.pass = pass;
+            job.stride = s_passStrides[pass];
+            MandelbrotTileScheduler scheduler(tiles, estimateTileCosts(&job, tiles), nWorkers);
+            job.scheduler = &scheduler;
+
+            std::vector<qint64> busyTimes(nWorkers, 0);
+            auto runWorker = [this, &job, &busyTimes](int k) {
+                QElapsedTimer timer;
+                timer.start();
+                renderTiles(&job, k);
+                busyTimes[k] = timer.nsecsElapsed();
+            };
+
+            QElapsedTimer passTimer;
+            passTimer.start();
+            QList<QFuture<void> > futures;
+            for(int k=1; k<scheduler.getNWorkers(); k++) {
+                futures << QtConcurrent::run(m_threadPool, [&runWorker, k]() {
+                    runWorker(k);
+                });
+            }
+            runWorker(0);
+            for(int k=0; k<futures.size(); k++) {
+                futures[k].waitForFinished();
             }
+            qint64 passTime = passTimer.nsecsElapsed();
 
-            MandelbrotPoint p = buffer[i*h+j];
+            for(int k=0; k<nWorkers; k++) {
+                workerStats[k].busyTime += busyTimes[k];
+                workerStats[k].idleTime += std::max<qint64>(passTime - busyTimes[k], 0);
+                if(pass > 0) workerStats[k].predictedCost += scheduler.getPredictedCost(k);
+            }
 
-            image.setPixelColor(i, j, m_themeManager->getColor(p));
+            if(m_canceled.load()) {
+                emit(progressChanged(0));
+                return false;
+            }
 
-            int prog = 100*i/w;
-            if(prog!=progress){
-                progress = prog;
-                emit(progressChanged(progress));
+            if(job.stride > 1) {
+                emit(partialImageReady(makePreview(buffer, isComputed, w, h, job.stride, image.format()), viewport));
             }
+            job.previousStride = job.stride;
         }
+
+        // The complete image becomes the front one by swapping the buffers, without copying them.
+        m_buffer.swap(m_backBuffer);
+        m_orbitStates.swap(m_backOrbitStates);
+        m_width = w;
+        m_height = h;
+        m_viewport = viewport;
+        m_isBufferUpToDate = true;
+        m_isPreview = isPreview;
+        m_isBufferResumable = !m_orbitStates.empty();
+        m_bufferPrecision = m_precision;
+        m_bufferPrecisionTier = m_precisionTier;
+        m_bufferRenderingMethod = job.renderingMethod;
+        m_bufferFields = fields;
+
+        QMutexLocker locker(&m_workerStatsMutex);
+        m_workerStats.swap(workerStats);
     }
 
-    m_width = w;
-    m_height = h;
-    m_xmin = xmin;
-    m_xmax = xmax;
-    m_ymin = ymin;
-    m_ymax = ymax;
-    m_buffer = buffer;
-    m_isBufferUpToDate = true;
+    emit(progressChanged(100));
+
+    m_theme->setMandelbrotSet(this);
+
+    if(!colorize(image, m_buffer, 0, 1, true)) {
+        emit(progressChanged(0));
+        return false;
+    }
 
     emit(progressChanged(100));
     emit(pixmapReady());
@@ -125,24 +542,192 @@ bool MandelbrotSet::fillPixmap(QImage &image, double xmin, double xmax, double y
     return true;
 }
 
+/**
+ * @param buffer Buffer filled by a coarse pass.
+ * @param isComputed Flags the pixels of the buffer already computed.
+ * @param w Width of the image.
+ * @param h Height of the image.
+ * @param stride Spacing in pixels of the grid computed by the pass.
+ * @param format Format of the image.
+ * @return An image of size w x h.
+ */
+QImage MandelbrotSet::makePreview(const MandelbrotPointBuffer &buffer, const std::vector<char> &isComputed,
+                                  int w, int h, int stride, QImage::Format format)
+{
+    m_theme->setMandelbrotSet(this);
+
+    QImage preview(w, h, format);
+    colorize(preview, buffer, &isComputed, stride, false);
+    return preview;
+}
+
+/**
+ * The image is split in bands of rows, processed in parallel. Each band is
+ * walked one column at a time, which reads the buffer contiguously while
+ * writing packed colors straight into the scanlines of the band.
+ *
+ * When some pixels are not computed yet, they take the color of the computed
+ * pixel at the top left corner of their stride x stride block.
+ *
+ * @param image Image to be filled, converted to 32-bit RGB if needed.
+ * @param buffer Convergence test results, with the size of the image.
+ * @param isComputed Flags the computed pixels of the buffer, null if they all are.
+ * @param stride Spacing in pixels of the grid of computed pixels.
+ * @param isReportingProgress true to report the progress of the colorization.
+ * @return false if the calculation was canceled.
+ */
+bool MandelbrotSet::colorize(QImage &image, const MandelbrotPointBuffer &buffer,
+                             const std::vector<char> *isComputed, int stride, bool isReportingProgress)
+{
+    if(image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32 &&
+            image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = image.convertToFormat(QImage::Format_RGB32);
+    }
+
+    int w = image.width();
+    int h = image.height();
+    uchar *bits = image.bits();
+    int bytesPerLine = image.bytesPerLine();
+    // The histogram is the one of the buffer being colorized, not of the last complete image.
+    if(m_theme->getThemeInfo().getThemeType() == MandelbrotThemeInfo::Histogram) {
+        m_theme->setEscapeTimeHistogram(getEscapeTimeHistogram(buffer, isComputed));
+    }
+    const MandelbrotTheme &theme = *m_theme;
+
+    int nBands = (h + s_colorizeBandHeight - 1) / s_colorizeBandHeight;
+    QAtomicInt nextBand(0);
+    QAtomicInt nDoneBands(0);
+    m_progress.store(-1);
+
+    auto colorizeBands = [&]() {
+        QRgb *lines[s_colorizeBandHeight];
+        int band;
+        while((band = nextBand.fetchAndAddRelaxed(1)) < nBands) {
+
+            if(m_canceled.load()) return;
+
+            int j0 = band * s_colorizeBandHeight;
+            int j1 = std::min(j0 + s_colorizeBandHeight, h);
+            for(int j=j0; j<j1; j++) {
+                lines[j-j0] = (QRgb *)(bits + (qptrdiff)j * bytesPerLine);
+            }
+
+            for(int i=0; i<w; i++){
+                for(int j=j0; j<j1; j++){
+                    int k = i*h+j;
+                    if(isComputed && !(*isComputed)[k]) {
+                        k = (i - i % stride) * h + (j - j % stride);
+                    }
+                    lines[j-j0][i] = theme.getRgb(buffer.get(k));
+                }
+            }
+
+            if(isReportingProgress) {
+                int prog = 100 * (nDoneBands.fetchAndAddOrdered(1) + 1) / nBands;
+                int progress = m_progress.load();
+                if(prog > progress && m_progress.testAndSetOrdered(progress, prog)) {
+                    emit(progressChanged(prog));
+                }
+            }
+        }
+    };
+
+    // The calling thread takes part in the colorization.
+    QList<QFuture<void> > futures;
+    int nWorkers = std::min(m_threadPool->maxThreadCount(), nBands);
+    for(int k=1; k<nWorkers; k++) {
+        futures << QtConcurrent::run(m_threadPool, colorizeBands);
+    }
+    colorizeBands();
+    for(int k=0; k<futures.size(); k++) {
+        futures[k].waitForFinished();
+    }
+
+    return !m_canceled.load();
+}
+
+/**
+ * Pixels of the previous image are kept wherever they fall exactly on pixels
+ * of the new one: on a pan by a whole number of pixels, the overlapping region
+ * is shifted, and on a zoom by 2 every other pixel is kept along both axes.
+ *
+ * @param viewport Region of the complex plane mapped to the new image.
+ * @param w Width of the new image.
+ * @param h Height of the new image.
+ * @param buffer Buffer of the new image, receiving the kept pixels.
+ * @param orbitStates Orbits of the new image if they are kept, receiving the orbits of the kept pixels.
+ * @param isComputed Flags the pixels of the new buffer, set for the kept pixels.
+ * @return The number of pixels kept.
+ */
+int MandelbrotSet::reuseBuffer(const MandelbrotViewport &viewport, int w, int h, MandelbrotPointBuffer &buffer,
+                               std::vector<MandelbrotOrbitState> &orbitStates, std::vector<char> &isComputed) const
+{
+    if(m_buffer.empty()) return 0;
+
+    // Position of the new pixels in units of old pixels, from the bottom left corner.
+    double oldSpacingX = m_viewport.getWidth() / m_width;
+    double oldSpacingY = m_viewport.getHeight() / m_height;
+    double scaleX = viewport.getWidth() / w / oldSpacingX;
+    double scaleY = viewport.getHeight() / h / oldSpacingY;
+    double offsetX = ((viewport.getCenterX() - m_viewport.getCenterX()).toDouble() -
+                      (viewport.getWidth() - m_viewport.getWidth()) / 2) / oldSpacingX;
+    double offsetY = ((viewport.getCenterY() - m_viewport.getCenterY()).toDouble() -
+                      (viewport.getHeight() - m_viewport.getHeight()) / 2) / oldSpacingY;
+
+    auto toOldPixel = [](double position, int size) {
+        double k = floor(position + 0.5);
+        if(fabs(position - k) > s_reuseTolerance || k < 0 || k >= size) return -1;
+        return (int)k;
+    };
+
+    std::vector<int> columns(w);
+    for(int i=0; i<w; i++) {
+        columns[i] = toOldPixel(offsetX + i * scaleX, m_width);
+    }
+    std::vector<int> rows(h);
+    for(int j=0; j<h; j++) {
+        int l = toOldPixel(offsetY + (h-j-1) * scaleY, m_height);
+        rows[j] = l < 0 ? -1 : m_height - l - 1;
+    }
+
+    bool hasOrbitStates = !orbitStates.empty() && (int)m_orbitStates.size() == m_buffer.size();
+    int nReused = 0;
+    for(int i=0; i<w; i++) {
+        if(columns[i] < 0) continue;
+        for(int j=0; j<h; j++) {
+            if(rows[j] < 0) continue;
+            buffer.copy(i*h+j, m_buffer, columns[i]*m_height+rows[j]);
+            if(hasOrbitStates) orbitStates[i*h+j] = m_orbitStates[columns[i]*m_height+rows[j]];
+            isComputed[i*h+j] = 1;
+            nReused++;
+        }
+    }
+    return nReused;
+}
+
 double MandelbrotSet::getXmin() const
 {
-    return m_xmin;
+    return m_viewport.getXmin();
 }
 
 double MandelbrotSet::getXmax() const
 {
-    return m_xmax;
+    return m_viewport.getXmax();
 }
 
 double MandelbrotSet::getYmin() const
 {
-    return m_ymin;
+    return m_viewport.getYmin();
 }
 
 double MandelbrotSet::getYmax() const
 {
-    return m_ymax;
+    return m_viewport.getYmax();
+}
+
+const MandelbrotViewport &MandelbrotSet::getViewport() const
+{
+    return m_viewport;
 }
 
 double MandelbrotSet::getOrder() const
@@ -157,69 +742,700 @@ int MandelbrotSet::getPrecision() const
 
 double MandelbrotSet::getZoomFactor() const
 {
-    double zoomFactor = 1;
-    if(m_xmax - m_xmin > m_ymax - m_ymin) {
-        zoomFactor = 4. / (m_xmax - m_xmin);
+    return m_viewport.getZoomFactor();
+}
+
+/**
+ * @return true if the arithmetic of the last complete image was only selected
+ * because it is a preview: the final image has to be computed again.
+ */
+bool MandelbrotSet::isPreview() const
+{
+    return m_isPreview;
+}
+
+/**
+ * @return The arithmetic used by the last calculation.
+ */
+MandelbrotSet::PrecisionTier MandelbrotSet::getPrecisionTier() const
+{
+    return m_precisionTier;
+}
+
+/**
+ * @return A short explanation of why the arithmetic of the last calculation was selected.
+ */
+QString MandelbrotSet::getPrecisionTierReason() const
+{
+    return m_precisionTierReason;
+}
+
+/**
+ * @param precisionTier An arithmetic.
+ * @return The name of the arithmetic.
+ */
+QString MandelbrotSet::getPrecisionTierName(PrecisionTier precisionTier)
+{
+    switch(precisionTier) {
+    case FloatTier: return "Single";
+    case DoubleTier: return "Double";
+    case DoubleDoubleTier: return "Double-double";
+    case PerturbationTier: return "Perturbation";
+    default: return "";
+    }
+}
+
+/**
+ * The fields left out by a theme type are not computed, which saves
+ * the derivative of the orbits and the iterations past the escape
+ * needed by the distance estimate.
+ *
+ * @param type A theme type.
+ * @return The fields used to color the points, as PointField flags.
+ */
+int MandelbrotSet::getRequiredFields(MandelbrotThemeInfo::ThemeType type)
+{
+    switch(type) {
+    case MandelbrotThemeInfo::BiColor:
+    case MandelbrotThemeInfo::EscapeTime:
+    case MandelbrotThemeInfo::Histogram:
+        return EscapeTimeOnly;
+    case MandelbrotThemeInfo::Continuous:
+        return RadiusField;
+    case MandelbrotThemeInfo::Distance:
+        return DistanceField;
+    default:
+        return AllFields;
+    }
+}
+
+/**
+ * @return The number of iterations saved by the periodicity checks during the last calculation.
+ */
+qint64 MandelbrotSet::getSkippedIterations() const
+{
+    return m_skippedIterations.load();
+}
+
+/**
+ * @return The number of iterations skipped by the series approximation during the last calculation.
+ */
+qint64 MandelbrotSet::getApproximatedIterations() const
+{
+    return m_approximatedIterations.load();
+}
+
+/**
+ * Counts the front and back buffers of the results and the orbits kept to be resumed,
+ * which is what a calculation of the same size needs.
+ *
+ * @return The number of bytes held per pixel of the last image, 0 before the first calculation.
+ */
+double MandelbrotSet::getBytesPerPixel() const
+{
+    if(m_buffer.empty()) return 0;
+
+    qint64 bytes = m_buffer.getMemorySize() + m_backBuffer.getMemorySize() +
+            (qint64)(m_orbitStates.capacity() + m_backOrbitStates.capacity()) * sizeof(MandelbrotOrbitState);
+    return (double)bytes / m_buffer.size();
+}
+
+/**
+ * The cheapest arithmetic that still resolves the pixels is selected,
+ * based on the pixel spacing relative to the coordinates of the center:
+ * - Single precision for zoom factors below s_floatZoomLimit, and for
+ * previews as long as the relative spacing is above s_floatResolution.
+ * It is only cheaper when vector instructions are available.
+ * - Double precision down to a relative spacing of s_doubleResolution.
+ * - Double-double precision down to s_doubleDoubleResolution.
+ * - Perturbation beyond that.
+ * Only the order 2 is computed in other precisions than double,
+ * and resumable orbits are never computed in single precision.
+ *
+ * @param viewport Region of the complex plane being rendered.
+ * @param pixelSpacing Distance between two pixels.
+ * @param reason Receives a short explanation of the choice.
+ * @return The arithmetic to be used.
+ */
+MandelbrotSet::PrecisionTier MandelbrotSet::selectPrecisionTier(const MandelbrotViewport &viewport, double pixelSpacing,
+                                                                QString &reason) const
+{
+    double scale = std::max(fabs(viewport.getCenterX().toDouble()), fabs(viewport.getCenterY().toDouble()));
+    double relativeSpacing = pixelSpacing / scale;
+    QString spacing = QString("pixel spacing is %1 of the center coordinates").arg(relativeSpacing, 0, 'g', 2);
+
+    if(m_order != 2) {
+        if(relativeSpacing < s_doubleResolution) {
+            reason = spacing + ", too small for doubles, but only the order 2 has higher precisions";
+        }else{
+            reason = "only the order 2 has other precisions";
+        }
+        return DoubleTier;
+    }
+
+    if(relativeSpacing < s_doubleDoubleResolution) {
+        reason = spacing + ", too small for double-doubles";
+        return PerturbationTier;
+    }
+
+    if(relativeSpacing < s_doubleResolution) {
+        reason = spacing + ", too small for doubles";
+        return DoubleDoubleTier;
+    }
+
+    if(m_isResumable) {
+        reason = "resumable orbits are kept in double precision";
+        return DoubleTier;
+    }
+
+    bool isFloatAccurate = viewport.getZoomFactor() < s_floatZoomLimit;
+    if(isFloatAccurate) {
+        reason = QString("zoom factor is below %1").arg(s_floatZoomLimit);
+    }else if(m_isFastPreview && relativeSpacing > s_floatResolution) {
+        isFloatAccurate = true;
+        reason = "preview, " + spacing;
+    }
+    if(isFloatAccurate && MandelbrotSimdKernel::selectFloat(m_order)) {
+        return FloatTier;
+    }
+
+    if(isFloatAccurate) {
+        reason = "no vector instructions for single precision";
     }else{
-        zoomFactor = 4. / (m_ymax - m_ymin);
+        reason = spacing + ", too small for floats";
     }
-    return zoomFactor;
+    return DoubleTier;
 }
 
-const std::vector<MandelbrotSet::MandelbrotPoint> &MandelbrotSet::getBuffer() const
+/**
+ * The ongoing calculation fills a separate back buffer: this one holds the
+ * last complete image until the buffers are swapped at the end of the next one.
+ *
+ * @return The buffer of the last complete calculation.
+ */
+const MandelbrotPointBuffer &MandelbrotSet::getBuffer() const
 {
     return m_buffer;
 }
 
+/**
+ * @return Number of points of the buffer for each escape time, up to the largest one.
+ */
+std::vector<int> MandelbrotSet::getEscapeTimeHistogram() const
+{
+    return getEscapeTimeHistogram(m_buffer, 0);
+}
+
+/**
+ * The buffer is split into slices counted by the pool threads and the
+ * calling thread, each one in its own histogram. The partial histograms
+ * are summed at the end. They only grow up to the largest escape time
+ * of their slice, which is usually far below the precision.
+ *
+ * @param buffer Convergence test results.
+ * @param isComputed Flags the computed pixels of the buffer, null if they all are.
+ * @return Number of computed points of the buffer for each escape time, up to the largest one.
+ */
+std::vector<int> MandelbrotSet::getEscapeTimeHistogram(const MandelbrotPointBuffer &buffer,
+                                                       const std::vector<char> *isComputed) const
+{
+    int size = buffer.size();
+    int nSlices = std::max(1, std::min(m_threadPool->maxThreadCount(), size / (s_tileSize * s_tileSize)));
+    std::vector<std::vector<int> > partials(nSlices);
+
+    auto countSlice = [&](int k) {
+        std::vector<int> &histogram = partials[k];
+        int end = (qint64)size * (k + 1) / nSlices;
+        for(int i=(qint64)size * k / nSlices; i<end; i++) {
+            if(isComputed && !(*isComputed)[i]) continue;
+            int n = buffer.getN(i);
+            if(n >= 0 && n < m_precision) {
+                if(n >= (int)histogram.size()) histogram.resize(n + 1, 0);
+                histogram[n]++;
+            }
+        }
+    };
+
+    QList<QFuture<void> > futures;
+    for(int k=1; k<nSlices; k++) {
+        futures << QtConcurrent::run(m_threadPool, [&countSlice, k]() { countSlice(k); });
+    }
+    countSlice(0);
+    for(int k=0; k<futures.size(); k++) {
+        futures[k].waitForFinished();
+    }
+
+    std::vector<int> &histogram = partials[0];
+    for(int k=1; k<nSlices; k++) {
+        if(partials[k].size() > histogram.size()) histogram.resize(partials[k].size(), 0);
+        for(unsigned int n=0; n<partials[k].size(); n++) {
+            histogram[n] += partials[k][n];
+        }
+    }
+    return histogram;
+}
+
 MandelbrotThemeManager *MandelbrotSet::getThemeManager()
 {
     return m_themeManager;
 }
 
+/**
+ * The idle time of a worker is the time it waited for the others at the end
+ * of the passes: with a well balanced load, it stays small before the busy time.
+ *
+ * @return One entry per worker, the calling thread being the first one.
+ */
+std::vector<MandelbrotWorkerStats> MandelbrotSet::getWorkerStats() const
+{
+    QMutexLocker locker(&m_workerStatsMutex);
+    return m_workerStats;
+}
+
+/**
+ * The tiles may belong to a calculation that was canceled since,
+ * they tell the region of the image they were computed for.
+ *
+ * @return The tiles in the order they were completed.
+ */
+std::vector<MandelbrotTileImage> MandelbrotSet::takeCompletedTiles()
+{
+    return m_completedTiles.takeAll();
+}
+
+/**
+ * The workers poll the flag between pixels or batches of pixels,
+ * so that the calculation stops shortly after the call.
+ */
 void MandelbrotSet::cancel()
 {
-    m_canceled = true;
+    m_canceled.store(1);
+}
+
+void MandelbrotSet::resetCancel()
+{
+    m_canceled.store(0);
+}
+
+/**
+ * Each pixel is computed exactly as in a serial sweep of the image:
+ * the result does not depend on the number of workers nor on the order
+ * in which the tiles are processed.
+ *
+ * @param job The calculation being performed.
+ * @param worker Index of this worker in the scheduler.
+ */
+void MandelbrotSet::renderTiles(RenderJob *job, int worker)
+{
+    int w = job->w;
+    int h = job->h;
+    double xmin = job->xmin;
+    double xmax = job->xmax;
+    double ymin = job->ymin;
+    double ymax = job->ymax;
+    MandelbrotPointBuffer &buffer = *job->buffer;
+
+    MandelbrotKernelStats stats;
+    stats.skippedIterations = 0;
+    stats.approximatedIterations = 0;
+
+    MandelbrotPoint out[s_tileSize];
+    int rows[s_tileSize];
+    int stride = job->stride;
+
+    MandelbrotTile tile;
+    while(job->scheduler->next(worker, tile)) {
+
+        // The shortcuts of the rendering methods need every pixel: they are left to the last pass,
+        // which reuses the pixels computed by the previous ones.
+        if(stride == 1 && job->renderingMethod == MandelbrotThemeInfo::RectangleSubdivision) {
+
+            if(!renderTileSubdivided(job, tile, stats)) return;
+
+        }else if(stride == 1 && job->renderingMethod == MandelbrotThemeInfo::BoundaryTracing) {
+
+            if(!renderTileTraced(job, tile, stats)) return;
+
+        }else if(job->batchTestDoubleDouble || job->batchTest) {
+
+            // The pending pixels of each column of the tile are processed as a single batch.
+            double x0Hi[s_tileSize];
+            double x0Lo[s_tileSize];
+            double y0Hi[s_tileSize];
+            double y0Lo[s_tileSize];
+            for(int i=tile.x0; i<tile.x1; i++){
+
+                if(m_canceled.load()) return;
+
+                int count = 0;
+                for(int j=tile.y0; j<tile.y1; j++){
+                    if(!job->isPending(i, j)) continue;
+                    if(job->batchTestDoubleDouble) {
+                        MandelbrotKernel::DoubleDouble x;
+                        MandelbrotKernel::DoubleDouble y;
+                        job->getDoubleDoublePoint(i, j, x, y);
+                        x0Hi[count] = x.hi;
+                        x0Lo[count] = x.lo;
+                        y0Hi[count] = y.hi;
+                        y0Lo[count] = y.lo;
+                    }else{
+                        x0Hi[count] = xmin + i * (xmax - xmin) / w;
+                        y0Hi[count] = ymin + (h-j-1) * (ymax - ymin) / h;
+                    }
+                    rows[count++] = j;
+                }
+                if(count == 0) continue;
+
+                if(job->batchTestDoubleDouble) {
+                    job->batchTestDoubleDouble(x0Hi, x0Lo, y0Hi, y0Lo, count, out, job->params, stats);
+                }else{
+                    job->batchTest(x0Hi, y0Hi, count, out, job->params, stats);
+                }
+                for(int k=0; k<count; k++) {
+                    buffer.set(i*h+rows[k], out[k]);
+                    (*job->isComputed)[i*h+rows[k]] = 1;
+                }
+            }
+
+        }else{
+
+            for(int i=tile.x0; i<tile.x1; i+=stride){
+                for(int j=tile.y0; j<tile.y1; j++){
+
+                    if(m_canceled.load()) return;
+
+                    if(job->isPending(i, j)) job->compute(i, j, stats);
+                }
+            }
+        }
+
+        int nPixels = job->countPassPixels(tile);
+        int rendered = m_renderedPixels.fetchAndAddOrdered(nPixels) + nPixels;
+        int prog = (long long)100 * rendered / (w*h);
+        int progress = m_progress.load();
+        if(prog > progress && m_progress.testAndSetOrdered(progress, prog)) {
+            emit(progressChanged(prog));
+        }
+
+        (*job->workerStats)[worker].nTiles++;
+
+        if(job->pass == 0) {
+            recordTileCost(job, tile);
+        }
+
+        if(stride == 1 && job->isStreamingTiles) {
+            pushTile(job, tile);
+        }
+    }
+
+    m_skippedIterations.fetchAndAddOrdered(stats.skippedIterations);
+    m_approximatedIterations.fetchAndAddOrdered(stats.approximatedIterations);
+}
+
+/**
+ * @param job The calculation being performed.
+ * @param tile The tile to be processed.
+ * @param stats Statistics to be updated.
+ * @return false if the calculation was canceled.
+ */
+bool MandelbrotSet::renderTileSubdivided(RenderJob *job, const MandelbrotTile &tile, MandelbrotKernelStats &stats)
+{
+    return subdivide(job, tile, stats);
 }
 
-MandelbrotSet::MandelbrotPoint MandelbrotSet::doConvergenceTest(double x0, double y0)
+/**
+ * This is the Mariani-Silver algorithm: the set being connected,
+ * if all the pixels on the border of a rectangle have the same escape
+ * time, so do all the pixels inside. The inside is then filled
+ * without being tested. Otherwise the rectangle is split in two halves
+ * sharing their middle line, and each half is processed in turn.
+ *
+ * The pixels computed by the previous passes are kept as they are,
+ * and they take part in the uniformity check along with the border.
+ *
+ * @param job The calculation being performed.
+ * @param rect The rectangle to be processed.
+ * @param stats Statistics to be updated.
+ * @return false if the calculation was canceled.
+ */
+bool MandelbrotSet::subdivide(RenderJob *job, const MandelbrotTile &rect, MandelbrotKernelStats &stats)
 {
+    int h = job->h;
+    MandelbrotPointBuffer &buffer = *job->buffer;
+    std::vector<char> &isComputed = *job->isComputed;
 
-    MandelbrotPoint p;
-    p.de = 0;
+    int n = 0;
+    bool isUniform = true;
+    bool isFirst = true;
+    auto testBorder = [&](int i, int j) {
+        int pn = job->compute(i, j, stats).n;
+        if(isFirst) n = pn;
+        else if(pn != n) isUniform = false;
+        isFirst = false;
+    };
 
-    double rcut2 = 4;
-    int niterDist = 1000;
-    double rcutDist = 1000;
-    bool hasExitedDist = false;
+    for(int i=rect.x0; i<rect.x1; i++) {
+        if(m_canceled.load()) return false;
+        testBorder(i, rect.y0);
+        testBorder(i, rect.y1-1);
+    }
+    for(int j=rect.y0+1; j<rect.y1-1; j++) {
+        if(m_canceled.load()) return false;
+        testBorder(rect.x0, j);
+        testBorder(rect.x1-1, j);
+    }
+
+    int width = rect.x1 - rect.x0;
+    int height = rect.y1 - rect.y0;
+    if(width <= 2 || height <= 2) {
+        return true;
+    }
 
-    Complex c(x0, y0);
-    Complex z(0,0);
-    Complex dz(1,0);
-    Complex one(1,0);
-    p.n = -1;
-    bool hasExited = false;
-    for(int i=0; i<m_precision; i++){
-        dz = m_order * std::pow(z, m_order-1) * dz + one;
-        z = std::pow(z, m_order) + c;
-        double r2 = std::norm(z);
-        if(!hasExited && r2 > rcut2){
-            p.n = i;
-            p.r = sqrt(r2);
-            hasExited = true;
+    // The pixels computed inside by the previous passes must agree with the border as well.
+    for(int i=rect.x0+1; i<rect.x1-1 && isUniform; i++) {
+        for(int j=rect.y0+1; j<rect.y1-1; j++) {
+            if(isComputed[i*h+j] && buffer.getN(i*h+j) != n) {
+                isUniform = false;
+                break;
+            }
         }
-        double dr = std::abs(dz);
-        if(!hasExitedDist && (i > niterDist || dr > rcutDist)) {
-            double r = sqrt(r2);
-            p.de = r * log(r)/dr;
-            if(std::isnan(p.de)) {
-                qDebug() << p.de << r << log(r) << dr;
+    }
+
+    if(isUniform) {
+        MandelbrotPoint p = buffer.get(rect.x0*h+rect.y0);
+        for(int i=rect.x0+1; i<rect.x1-1; i++) {
+            for(int j=rect.y0+1; j<rect.y1-1; j++) {
+                if(isComputed[i*h+j]) continue;
+                buffer.set(i*h+j, p);
+                isComputed[i*h+j] = 1;
             }
-            hasExitedDist = true;
         }
-        if(hasExited && hasExitedDist){
-            break;
+        return true;
+    }
+
+    MandelbrotTile first = rect;
+    MandelbrotTile second = rect;
+    if(width >= height) {
+        first.x1 = (rect.x0 + rect.x1) / 2 + 1;
+        second.x0 = first.x1 - 1;
+    }else{
+        first.y1 = (rect.y0 + rect.y1) / 2 + 1;
+        second.y0 = first.y1 - 1;
+    }
+    return subdivide(job, first, stats) &&
+            subdivide(job, second, stats);
+}
+
+/**
+ * The pixels on the edges of the tile are tested first. Whenever a tested
+ * pixel has a different escape time than one of its tested neighbours,
+ * both lie on the contour of a region: their untested neighbours are queued
+ * to be tested in turn. This walks along every contour reachable from the
+ * edges of the tile while leaving the inside of the regions untested.
+ * The untested pixels are finally flood-filled row by row from their
+ * left neighbour, which is part of the same region.
+ *
+ * @param job The calculation being performed.
+ * @param tile The tile to be processed.
+ * @param stats Statistics to be updated.
+ * @return false if the calculation was canceled.
+ */
+bool MandelbrotSet::renderTileTraced(RenderJob *job, const MandelbrotTile &tile, MandelbrotKernelStats &stats)
+{
+    enum PixelState { Untested, Queued, Tested };
+
+    int h = job->h;
+    int tileWidth = tile.x1 - tile.x0;
+    int tileHeight = tile.y1 - tile.y0;
+    MandelbrotPointBuffer &buffer = *job->buffer;
+    std::vector<char> &isComputed = *job->isComputed;
+
+    std::vector<char> state(tileWidth * tileHeight, Untested);
+    std::vector<int> queue;
+    auto enqueue = [&](int i, int j) {
+        if(i < tile.x0 || i >= tile.x1 || j < tile.y0 || j >= tile.y1) return;
+        int k = (i - tile.x0) * tileHeight + (j - tile.y0);
+        if(state[k] != Untested) return;
+        state[k] = Queued;
+        queue.push_back(k);
+    };
+    auto enqueueNeighbours = [&](int i, int j) {
+        for(int di=-1; di<=1; di++) {
+            for(int dj=-1; dj<=1; dj++) {
+                enqueue(i+di, j+dj);
+            }
+        }
+    };
+
+    for(int i=tile.x0; i<tile.x1; i++) {
+        enqueue(i, tile.y0);
+        enqueue(i, tile.y1-1);
+    }
+    for(int j=tile.y0; j<tile.y1; j++) {
+        enqueue(tile.x0, j);
+        enqueue(tile.x1-1, j);
+    }
+
+    // The pixels computed by the previous passes, or reused, are seeds as well:
+    // the pixels between seeds that disagree are traced, which finds the islands
+    // enclosed by a uniform border.
+    auto hasUniformNeighbours = [&](int i, int j, int &uniformK) {
+        uniformK = -1;
+        for(int ni=std::max(i-1, tile.x0); ni<=std::min(i+1, tile.x1-1); ni++) {
+            for(int nj=std::max(j-1, tile.y0); nj<=std::min(j+1, tile.y1-1); nj++) {
+                int nk = ni*h+nj;
+                if(!isComputed[nk]) continue;
+                if(uniformK >= 0 && buffer.getN(nk) != buffer.getN(uniformK)) return false;
+                uniformK = nk;
+            }
+        }
+        return true;
+    };
+    for(int i=tile.x0; i<tile.x1; i++) {
+        for(int j=tile.y0; j<tile.y1; j++) {
+            int uniformK;
+            if(isComputed[i*h+j] || !hasUniformNeighbours(i, j, uniformK)) {
+                enqueue(i, j);
+            }
         }
     }
-    return p;
+
+    static const int neighbours[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    while(!queue.empty()) {
+
+        if(m_canceled.load()) return false;
+
+        int k = queue.back();
+        queue.pop_back();
+        int i = tile.x0 + k / tileHeight;
+        int j = tile.y0 + k % tileHeight;
+
+        MandelbrotPoint p = job->compute(i, j, stats);
+        state[k] = Tested;
+
+        for(int d=0; d<4; d++) {
+            int ni = i + neighbours[d][0];
+            int nj = j + neighbours[d][1];
+            if(ni < tile.x0 || ni >= tile.x1 || nj < tile.y0 || nj >= tile.y1) continue;
+            if(!isComputed[ni*h+nj]) continue;
+            if(buffer.getN(ni*h+nj) != p.n) {
+                enqueueNeighbours(i, j);
+                enqueueNeighbours(ni, nj);
+            }
+        }
+    }
+
+    // The pixels left are surrounded by computed pixels that all agree.
+    // The first column is on the edge of the tile, hence always tested.
+    for(int j=tile.y0; j<tile.y1; j++) {
+        for(int i=tile.x0+1; i<tile.x1; i++) {
+            if(isComputed[i*h+j]) continue;
+            int uniformK;
+            hasUniformNeighbours(i, j, uniformK);
+            buffer.copy(i*h+j, buffer, uniformK >= 0 ? uniformK : (i-1)*h+j);
+        }
+    }
+
+    return true;
 }
 
+/**
+ * The consumer is only notified when the queue was empty:
+ * it takes all the tiles queued meanwhile at once.
+ *
+ * @param job The calculation being performed.
+ * @param tile The tile, whose pixels are all computed.
+ */
+void MandelbrotSet::pushTile(RenderJob *job, const MandelbrotTile &tile)
+{
+    int h = job->h;
+    const MandelbrotPointBuffer &buffer = *job->buffer;
+    const MandelbrotTheme &theme = *m_theme;
+
+    MandelbrotTileImage tileImage;
+    tileImage.tile = tile;
+    tileImage.viewport = *job->viewport;
+    tileImage.image = QImage(tile.x1 - tile.x0, tile.y1 - tile.y0, QImage::Format_RGB32);
+    for(int j=tile.y0; j<tile.y1; j++) {
+        QRgb *line = (QRgb *)tileImage.image.scanLine(j - tile.y0);
+        for(int i=tile.x0; i<tile.x1; i++) {
+            line[i - tile.x0] = theme.getRgb(buffer.get(i*h+j));
+        }
+    }
+
+    if(m_completedTiles.push(tileImage)) {
+        emit(tilesReady());
+    }
+}
+
+/**
+ * A pixel costs its number of iterations, the maximum for the points that do
+ * not diverge, plus a fixed overhead. The pixels of the first pass in the tile,
+ * all computed by now, are a low resolution probe of the cost of its other
+ * pixels. The pixels left to each of the next passes are counted as well,
+ * those reused from the previous image costing nothing.
+ *
+ * Each tile is recorded by the worker that processed it in the first pass,
+ * so that the records are made in parallel.
+ *
+ * @param job The calculation being performed.
+ * @param tile The tile, processed by the first pass.
+ */
+void MandelbrotSet::recordTileCost(RenderJob *job, const MandelbrotTile &tile)
+{
+    int h = job->h;
+    int probeStride = s_passStrides[0];
+    const MandelbrotPointBuffer &buffer = *job->buffer;
+    const std::vector<char> &isComputed = *job->isComputed;
+    auto firstOnGrid = [](int x, int s) { return (x + s - 1) / s * s; };
+    int index = job->getTileIndex(tile);
+
+    double probeCost = 0;
+    int nProbes = 0;
+    for(int i=firstOnGrid(tile.x0, probeStride); i<tile.x1; i+=probeStride) {
+        for(int j=firstOnGrid(tile.y0, probeStride); j<tile.y1; j+=probeStride) {
+            int n = buffer.getN(i*h+j);
+            probeCost += (n < 0 ? job->params.precision : n) + s_pixelOverhead;
+            nProbes++;
+        }
+    }
+    if(nProbes > 0) {
+        (*job->tilePixelCosts)[index] = probeCost / nProbes;
+    }
+
+    // Each pixel is computed by the first pass whose grid holds it.
+    int *nPending = &(*job->tilePendingPixels)[index * s_nPasses];
+    for(int i=tile.x0; i<tile.x1; i++) {
+        for(int j=tile.y0; j<tile.y1; j++) {
+            if(isComputed[i*h+j]) continue;
+            for(int pass=1; pass<s_nPasses; pass++) {
+                if(i % s_passStrides[pass] == 0 && j % s_passStrides[pass] == 0) {
+                    nPending[pass]++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * The costs of the next passes are read from the records of the first pass.
+ * During the first pass itself, all the pixels are assumed to cost the same.
+ *
+ * @param job The calculation being performed.
+ * @param tiles The tiles of the image.
+ * @return The predicted cost of each tile, in iterations.
+ */
+std::vector<double> MandelbrotSet::estimateTileCosts(const RenderJob *job, const std::vector<MandelbrotTile> &tiles) const
+{
+    std::vector<double> costs(tiles.size());
+    for(size_t k=0; k<tiles.size(); k++) {
+        if(job->pass == 0) {
+            costs[k] = RenderJob::countGridPixels(tiles[k], job->stride) * s_pixelOverhead;
+        }else{
+            int index = job->getTileIndex(tiles[k]);
+            costs[k] = (*job->tilePendingPixels)[index * s_nPasses + job->pass] * (*job->tilePixelCosts)[index];
+        }
+    }
+    return costs;
+}
@@ -3,8 +3,20 @@
 
 #include <QObject>
 #include <QPixmap>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QString>
 
+#include "mandelbrotthemeinfo.h"
+#include "mandelbrotviewport.h"
+#include "mandelbrotpointbuffer.h"
+#include "mandelbrottilequeue.h"
+
+class QThreadPool;
 class MandelbrotThemeManager;
+class MandelbrotTheme;
+struct MandelbrotKernelStats;
 
 /**
  * @brief The MandelbrotSet class.
@@ -28,6 +40,20 @@ class MandelbrotThemeManager;
  * converge and points that diverge. In the latter case, a continuous color
  * can be assigned based on how fast and how far the series diverge.
  * The details are documented in MandelbrotThemeManager.
+ *
+ * The convergence tests are split into square tiles that are processed
+ * in parallel by a pool of threads (see MandelbrotTileScheduler).
+ * Depending on the rendering method of the current theme, the inside of
+ * a tile may be filled from the tests performed on its boundary
+ * (see MandelbrotThemeInfo::RenderingMethod).
+ *
+ * The region to be rendered is a MandelbrotViewport. The arithmetic of the
+ * convergence tests is selected for each image (see PrecisionTier):
+ * shallow zooms and previews of the order 2 set are computed in single
+ * precision when vector instructions are available (see MandelbrotSimdKernel).
+ * Past the resolution of doubles, the order 2 set is computed in double-double
+ * precision (see MandelbrotDoubleDouble), then by perturbation past the
+ * resolution of double-doubles (see MandelbrotPerturbation).
  */
 class MandelbrotSet : public QObject
 {
@@ -41,27 +67,86 @@ public:
     /** Desctructor */
     ~MandelbrotSet();
 
+    /** Result of the convergence test of a point, defined along with MandelbrotPointBuffer. */
+    typedef ::MandelbrotPoint MandelbrotPoint;
+
     /**
-     * @brief The MandelbrotPoint structure.
+     * @brief The PointField enum
      *
-     * This structure holds information about the convergence/divergence
-     * of a point in the complex plane.
+     * Fields of a MandelbrotPoint that a convergence test fills on top of
+     * the escape time. The fields left out are set to 0.
      */
-    struct MandelbrotPoint {
-        int n; //!< Number of iteration before divergence. -1 in case of convergence.
-        double r; //!< Radius of the first point in the series larger than 2.
-        double de; //!< Estimate of the distance to the boundary of the set.
+    enum PointField {
+        EscapeTimeOnly = 0,                             //!< Only the escape time.
+        RadiusField = 1,                                //!< The radius of the first point out of the escape circle.
+        DistanceField = 2,                              //!< The distance estimate, which requires the derivative of the orbit.
+        AllFields = RadiusField | DistanceField         //!< Every field.
+    };
+
+    /**
+     * @brief The MandelbrotOrbitState structure.
+     *
+     * Where the convergence test of a point stopped when it ran out of iterations,
+     * so that it can be resumed once the precision is raised.
+     */
+    struct MandelbrotOrbitState {
+        int n; //!< Number of iterations performed, -1 once the test is complete.
+        int nextSave; //!< Next iteration at which the orbit is saved for the periodicity check.
+        bool hasExited; //!< Holds whether the orbit has escaped.
+        bool hasExitedDist; //!< Holds whether the distance estimate is known.
+        double zx; //!< Real part of the last point of the orbit.
+        double zy; //!< Imaginary part of the last point of the orbit.
+        double dzx; //!< Real part of the derivative of the last point.
+        double dzy; //!< Imaginary part of the derivative of the last point.
+        double zSavedx; //!< Real part of the point saved for the periodicity check.
+        double zSavedy; //!< Imaginary part of the point saved for the periodicity check.
+    };
+
+    /**
+     * @brief The PrecisionTier enum
+     *
+     * Arithmetic used to perform the convergence tests.
+     */
+    enum PrecisionTier {
+        FloatTier,          //!< Single precision, vectorized.
+        DoubleTier,         //!< Double precision.
+        DoubleDoubleTier,   //!< Double-double precision.
+        PerturbationTier    //!< Double precision offsets from a high precision reference orbit.
     };
 
     /** Fill an image: the image dimensions are mapped to the given range. */
     bool fillPixmap(QImage &image, double xmin, double xmax, double ymin, double ymax);
 
+    /** Fill an image: the image dimensions are mapped to the given region. */
+    bool fillPixmap(QImage &image, const MandelbrotViewport &viewport);
+
     /** Set the precision: i.e. the number of iterations before calling a convergence. */
     void setPrecision(int precision);
 
     /** Set the order of the set. */
     void setOrder(double order);
 
+    /** Set the theme colorizing the next images, independently of the theme manager. */
+    void setThemeInfo(const MandelbrotThemeInfo &themeInfo);
+
+    /** Set whether the next images are quick previews, computed in single precision. */
+    void setFastPreview(bool isFastPreview);
+
+    /** Set whether the orbits running out of iterations are kept, to be resumed when the precision is raised. */
+    void setResumable(bool isResumable);
+
+    /** Set whether the tiles of the last pass are colorized and queued as soon as they are complete. */
+    void setTileStreaming(bool isTileStreaming);
+
+    /** Set the point of the next images computed first, the tiles being processed outwards from it. */
+    void setFocus(double x, double y);
+
+    /** Check whether the orbits running out of iterations are kept. */
+    bool isResumable() const;
+
+    /** Check whether the next images are quick previews. */
+    bool isFastPreview() const;
+
     /** Get the lower boundary in the x coordinate system */
     double getXmin() const;
 
@@ -74,6 +159,9 @@ public:
     /** Get the upper boundary in the y coordinate system */
     double getYmax() const;
 
+    /** Get the region of the complex plane of the last filled image. */
+    const MandelbrotViewport &getViewport() const;
+
     /** Get the order of the set. */
     double getOrder() const;
 
@@ -83,17 +171,53 @@ public:
     /** Get the zoom factor. */
     double getZoomFactor() const;
 
-    /** Get the internal buffer. */
-    const std::vector<MandelbrotPoint> &getBuffer() const;
+    /** Get the number of iterations saved by the periodicity checks. */
+    qint64 getSkippedIterations() const;
+
+    /** Get the number of iterations skipped by the series approximation of deep zooms. */
+    qint64 getApproximatedIterations() const;
+
+    /** Get the memory held by the buffers of the calculations per pixel of the last image. */
+    double getBytesPerPixel() const;
+
+    /** Get the arithmetic used by the last calculation. */
+    PrecisionTier getPrecisionTier() const;
+
+    /** Check whether the last image is a quick preview, less accurate than the final image. */
+    bool isPreview() const;
+
+    /** Get the reason why the arithmetic of the last calculation was selected. */
+    QString getPrecisionTierReason() const;
+
+    /** Get the name of an arithmetic. */
+    static QString getPrecisionTierName(PrecisionTier precisionTier);
+
+    /** Get the fields of the convergence test results used by a theme type. */
+    static int getRequiredFields(MandelbrotThemeInfo::ThemeType type);
+
+    /** Get the internal buffer, holding the last complete calculation. */
+    const MandelbrotPointBuffer &getBuffer() const;
+
+    /** Count the diverging points of the internal buffer for each escape time, up to the largest one. */
+    std::vector<int> getEscapeTimeHistogram() const;
+
+    /** Get the activity of each worker during the last complete calculation. */
+    std::vector<MandelbrotWorkerStats> getWorkerStats() const;
 
     /** Get a pointer to the theme manager. */
     MandelbrotThemeManager *getThemeManager();
 
+    /** Take the tiles completed since the last call, from any thread. */
+    std::vector<MandelbrotTileImage> takeCompletedTiles();
+
 public slots:
 
-    /** Cancel ongoing calculation. */
+    /** Cancel ongoing calculation, and the ones started until resetCancel() is called. */
     void cancel();
 
+    /** Allow the next calculations to run after a call to cancel(). */
+    void resetCancel();
+
 signals:
 
     /** Signal a change in the rogress for the ongoing calculation. */
@@ -102,23 +226,100 @@ signals:
     /** Signal the end of the calculation */
     void pixmapReady();
 
+    /** Signal a coarse version of the image, available before the end of the calculation. */
+    void partialImageReady(const QImage &image, const MandelbrotViewport &viewport);
+
+    /** Signal that completed tiles are waiting in the queue, which was empty so far. */
+    void tilesReady();
+
 protected:
 
-    /** Performs a convergence test on a given point in the complex plane. */
-    MandelbrotPoint doConvergenceTest(double x0, double y0);
+    struct RenderJob;
+
+    /** Select the cheapest arithmetic resolving the pixels of an image. */
+    PrecisionTier selectPrecisionTier(const MandelbrotViewport &viewport, double pixelSpacing, QString &reason) const;
+
+    /** Process tiles from the scheduler until there is none left. */
+    void renderTiles(RenderJob *job, int worker);
+
+    /** Process a tile using the rectangle subdivision method. */
+    bool renderTileSubdivided(RenderJob *job, const MandelbrotTile &tile, MandelbrotKernelStats &stats);
+
+    /** Test the border of a rectangle, then fill or subdivide it. */
+    bool subdivide(RenderJob *job, const MandelbrotTile &rect, MandelbrotKernelStats &stats);
+
+    /** Process a tile using the boundary tracing method. */
+    bool renderTileTraced(RenderJob *job, const MandelbrotTile &tile, MandelbrotKernelStats &stats);
+
+    /** Record the predicted cost of the pixels of a tile left to the next passes. */
+    void recordTileCost(RenderJob *job, const MandelbrotTile &tile);
+
+    /** Estimate the cost of the pixels of each tile still to be computed by the current pass. */
+    std::vector<double> estimateTileCosts(const RenderJob *job, const std::vector<MandelbrotTile> &tiles) const;
+
+    /** Colorize a completed tile and queue it. */
+    void pushTile(RenderJob *job, const MandelbrotTile &tile);
+
+    /** Colorize the pixels computed by a coarse pass, the others taking the color of their block. */
+    QImage makePreview(const MandelbrotPointBuffer &buffer, const std::vector<char> &isComputed,
+                       int w, int h, int stride, QImage::Format format);
+
+    /** Count the diverging points of a buffer for each escape time, only among its computed pixels. */
+    std::vector<int> getEscapeTimeHistogram(const MandelbrotPointBuffer &buffer, const std::vector<char> *isComputed) const;
+
+    /** Fill an image with the colors of the convergence test results, using the current theme. */
+    bool colorize(QImage &image, const MandelbrotPointBuffer &buffer,
+                  const std::vector<char> *isComputed, int stride, bool isReportingProgress);
+
+    /** Copy the pixels of the previous image that are also pixels of a new one. */
+    int reuseBuffer(const MandelbrotViewport &viewport, int w, int h, MandelbrotPointBuffer &buffer,
+                    std::vector<MandelbrotOrbitState> &orbitStates, std::vector<char> &isComputed) const;
+
+    static const int s_tileSize = 32; //!< Size in pixels of the tiles processed by each thread.
+    static const int s_colorizeBandHeight = 32; //!< Number of rows colorized at once by each thread.
+    static const int s_nPasses = 3; //!< Number of passes of the progressive rendering.
+    static const int s_passStrides[s_nPasses]; //!< Spacing in pixels of the grid computed by each pass.
+    static const double s_reuseTolerance; //!< Largest distance in pixels between an old pixel and a new one it is reused for.
+    static const double s_doubleResolution; //!< Smallest pixel spacing relative to the coordinates computed with doubles.
+    static const double s_doubleDoubleResolution; //!< Smallest pixel spacing relative to the coordinates computed with double-doubles.
+    static const double s_floatResolution; //!< Smallest pixel spacing relative to the coordinates of a preview computed with floats.
+    static const double s_floatZoomLimit; //!< Zoom factor up to which the images are computed with floats.
+    static const int s_pixelOverhead; //!< Cost of a pixel besides its iterations, in iterations.
 
-    bool m_canceled; //!< Holds if the ongoing calculation should be canceled.
+    QAtomicInt m_canceled; //!< Holds if the ongoing calculation should be canceled, polled by all the workers.
+    bool m_isFastPreview; //!< Holds if the images are quick previews.
+    bool m_isPreview; //!< Holds if the buffer was computed in single precision only because it is a preview.
+    bool m_isResumable; //!< Holds if the orbits running out of iterations are kept.
+    bool m_isTileStreaming; //!< Holds if the completed tiles of the last pass are queued.
+    double m_focusX; //!< Column of the point computed first, as a fraction of the width of the image.
+    double m_focusY; //!< Row of the point computed first, as a fraction of the height of the image.
+    MandelbrotTileQueue m_completedTiles; //!< Tiles completed by the workers, waiting to be displayed.
+    PrecisionTier m_precisionTier; //!< Arithmetic used by the last calculation.
+    QString m_precisionTierReason; //!< Reason why the arithmetic of the last calculation was selected.
     int m_precision; //!< Precision: this is the number of iteration before calling a convergence.
     double m_order; //!< Order of the set.
-    std::vector<MandelbrotPoint> m_buffer; //!< buffer containing convergence test data.
+    MandelbrotPointBuffer m_buffer; //!< buffer containing convergence test data.
+    MandelbrotPointBuffer m_backBuffer; //!< Buffer being filled by the ongoing calculation.
     bool m_isBufferUpToDate; //!< Holds whether a buffer need to be updated.
+    std::vector<MandelbrotOrbitState> m_orbitStates; //!< Orbits of the buffer, empty unless they are kept.
+    std::vector<MandelbrotOrbitState> m_backOrbitStates; //!< Orbits being filled by the ongoing calculation.
+    bool m_isBufferResumable; //!< Holds whether the buffer can be completed by resuming its orbits.
+    int m_bufferPrecision; //!< Precision used to fill the buffer.
+    PrecisionTier m_bufferPrecisionTier; //!< Arithmetic used to fill the buffer.
+    MandelbrotThemeInfo::RenderingMethod m_bufferRenderingMethod; //!< Rendering method used to fill the buffer.
+    int m_bufferFields; //!< Fields of the results held by the buffer, as PointField flags.
     MandelbrotThemeManager *m_themeManager; //!< The theme manager.
+    MandelbrotTheme *m_theme; //!< Theme colorizing the images, only changed between calculations.
+    QThreadPool *m_threadPool; //!< Threads used to perform the convergence tests.
+    QAtomicInt m_renderedPixels; //!< Number of pixels processed so far by the ongoing calculation.
+    QAtomicInt m_progress; //!< Last progress reported by the ongoing calculation.
+    QAtomicInteger<qint64> m_skippedIterations; //!< Iterations saved by the periodicity checks.
+    QAtomicInteger<qint64> m_approximatedIterations; //!< Iterations skipped by the series approximation.
+    std::vector<MandelbrotWorkerStats> m_workerStats; //!< Activity of the workers during the last complete calculation.
+    mutable QMutex m_workerStatsMutex; //!< Protects the activity of the workers.
     int m_width; //!< Width in pixels of the last filled image.
     int m_height; //!< Height in pixels of the last filled image.
-    double m_xmin; //!< Lower boundary along the x (real) axis.
-    double m_xmax; //!< Upper boundary along the x (real) axis.
-    double m_ymin; //!< Lower boundary along the y (imaginary) axis.
-    double m_ymax; //!< Upper boundary along the y (imaginary) axis.
+    MandelbrotViewport m_viewport; //!< Region of the complex plane of the last filled image.
 };
 
 #endif // MANDELBROTSET_H
@@ -0,0 +1,460 @@
+#include "mandelbrotsimdkernel.h"
+
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MANDELBROT_HAS_SIMD
+#endif
+
+#ifdef MANDELBROT_HAS_SIMD
+
+namespace {
+
+typedef double Double4 __attribute__((vector_size(32)));
+typedef double Double8 __attribute__((vector_size(64)));
+typedef float Float8 __attribute__((vector_size(32)));
+typedef float Float16 __attribute__((vector_size(64)));
+
+/**
+ * Iterate L points in lockstep.
+ *
+ * The operations are written in the same order as in
+ * MandelbrotKernel::integerTest<2>() so that both give identical results
+ * when the lanes hold doubles. The lanes may also hold floats, which
+ * doubles the number of points per batch at the cost of the precision.
+ * Points inside the main cardioid or the period-2 bulb are classified
+ * before the loop, which is skipped entirely when the whole batch is inside.
+ * Without the distance estimate, the derivative is not computed and
+ * the lanes are done as soon as their orbit escapes.
+ * The vector types only turn into AVX2 or AVX-512 instructions
+ * once inlined into the functions compiled for these targets.
+ */
+template<typename VD, int L, bool HasDistance>
+inline __attribute__((always_inline)) void batchTestOrder2(const double *x0, const double *y0, int count,
+                                                           MandelbrotSet::MandelbrotPoint *out,
+                                                           const MandelbrotKernelParams &params,
+                                                           MandelbrotKernelStats &stats)
+{
+    typedef __typeof__(VD() > VD()) VI;
+    typedef __typeof__((*(VD *)0)[0]) Real;
+
+    const Real rcut2 = 4;
+    const int niterDist = 1000;
+    const Real rcutDist = 1000;
+    const Real periodicityTolerance2 = params.periodicityTolerance2;
+
+    for(int first=0; first<count; first+=L) {
+
+        VD cx = VD();
+        VD cy = VD();
+        VI isKnown = VI();
+        for(int k=0; k<L; k++) {
+            if(first + k < count) {
+                cx[k] = x0[first + k];
+                cy[k] = y0[first + k];
+                if(MandelbrotKernel::isInMainBulbs(x0[first + k], y0[first + k])) isKnown[k] = -1;
+            }else{
+                isKnown[k] = -1;
+            }
+        }
+
+        VD zx = VD();
+        VD zy = VD();
+        VD dzx = VD() + 1.;
+        VD dzy = VD();
+        VD zSavedx = VD();
+        VD zSavedy = VD();
+        int nextSave = 1;
+
+        // Padding lanes and points inside the main bulbs are done from the start.
+        VI hasExited = isKnown;
+        VI hasExitedDist = HasDistance ? isKnown : VI() - 1;
+        VI hasDistance = VI();
+        VI n = VI() - 1;
+        VI skipped = VI();
+        VD exitR2 = VD();
+        VD distR2 = VD();
+        VD distDr2 = VD();
+
+        for(int i=0; i<params.precision; i++){
+
+            // Iterating lanes that are done does not change their results:
+            // checking every few iterations keeps this scalar loop cheap.
+            if(i % 4 == 0) {
+                VI isDone = hasExited & hasExitedDist;
+                bool allDone = true;
+                for(int k=0; k<L; k++) {
+                    allDone = allDone && isDone[k];
+                }
+                if(allDone) break;
+            }
+
+            VD tx = 2. * zx;
+            VD ty = 2. * zy;
+            if(HasDistance) {
+                VD newDzx = tx * dzx - ty * dzy + 1.;
+                VD newDzy = tx * dzy + ty * dzx;
+                dzx = newDzx;
+                dzy = newDzy;
+            }
+            VD newZx = zx * zx - zy * zy + cx;
+            VD newZy = zx * zy + zy * zx + cy;
+            zx = newZx;
+            zy = newZy;
+
+            VD r2 = zx * zx + zy * zy;
+            VI exits = ~hasExited & (r2 > rcut2);
+            n = (exits & (VI() + i)) | (~exits & n);
+            exitR2 = (VD)((exits & (VI)r2) | (~exits & (VI)exitR2));
+            hasExited |= exits;
+
+            if(HasDistance) {
+                VD dr2 = dzx * dzx + dzy * dzy;
+                VI exitsDist = ~hasExitedDist & (dr2 > rcutDist * rcutDist);
+                if(i > niterDist) exitsDist = ~hasExitedDist;
+                distR2 = (VD)((exitsDist & (VI)r2) | (~exitsDist & (VI)distR2));
+                distDr2 = (VD)((exitsDist & (VI)dr2) | (~exitsDist & (VI)distDr2));
+                hasExitedDist |= exitsDist;
+                hasDistance |= exitsDist;
+            }
+
+            // Periodic orbits stop iterating with n = -1, keeping any distance estimate found so far.
+            VD dx = zx - zSavedx;
+            VD dy = zy - zSavedy;
+            VI isPeriodic = ~hasExited & (dx * dx + dy * dy < periodicityTolerance2);
+            skipped += isPeriodic & (VI() + (params.precision - i - 1));
+            hasExited |= isPeriodic;
+            hasExitedDist |= isPeriodic;
+            if(i == nextSave) {
+                zSavedx = zx;
+                zSavedy = zy;
+                nextSave *= 2;
+            }
+        }
+
+        for(int k=0; k<L && first + k < count; k++) {
+            stats.skippedIterations += skipped[k];
+            MandelbrotSet::MandelbrotPoint &p = out[first + k];
+            p.n = n[k];
+            p.r = p.n >= 0 && (params.fields & MandelbrotSet::RadiusField) ? sqrt((double)exitR2[k]) : 0;
+            p.de = 0;
+            if(hasDistance[k]) {
+                double r = sqrt((double)distR2[k]);
+                p.de = r * log(r)/sqrt((double)distDr2[k]);
+            }
+        }
+    }
+}
+
+/**
+ * Same as batchTestOrder2() in double-double precision,
+ * with the operations of MandelbrotKernel::doubleDoubleTest().
+ */
+template<typename VD, int L, bool HasDistance>
+inline __attribute__((always_inline)) void batchTestDoubleDoubleOrder2(const double *x0Hi, const double *x0Lo,
+                                                                       const double *y0Hi, const double *y0Lo,
+                                                                       int count, MandelbrotSet::MandelbrotPoint *out,
+                                                                       const MandelbrotKernelParams &params,
+                                                                       MandelbrotKernelStats &stats)
+{
+    typedef __typeof__(VD() > VD()) VI;
+    typedef MandelbrotDoubleDouble<VD> DD;
+
+    const double rcut2 = 4;
+    const int niterDist = 1000;
+    const double rcutDist = 1000;
+
+    for(int first=0; first<count; first+=L) {
+
+        DD cx;
+        DD cy;
+        VI isPadding = VI();
+        for(int k=0; k<L; k++) {
+            if(first + k < count) {
+                cx.hi[k] = x0Hi[first + k];
+                cx.lo[k] = x0Lo[first + k];
+                cy.hi[k] = y0Hi[first + k];
+                cy.lo[k] = y0Lo[first + k];
+            }else{
+                isPadding[k] = -1;
+            }
+        }
+
+        DD zx;
+        DD zy;
+        DD zSavedx;
+        DD zSavedy;
+        VD dzx = VD() + 1.;
+        VD dzy = VD();
+        int nextSave = 1;
+
+        VI hasExited = isPadding;
+        VI hasExitedDist = HasDistance ? isPadding : VI() - 1;
+        VI hasDistance = VI();
+        VI n = VI() - 1;
+        VI skipped = VI();
+        VD exitR2 = VD();
+        VD distR2 = VD();
+        VD distDr2 = VD();
+
+        for(int i=0; i<params.precision; i++){
+
+            // Iterating lanes that are done does not change their results:
+            // checking every few iterations keeps this scalar loop cheap.
+            if(i % 4 == 0) {
+                VI isDone = hasExited & hasExitedDist;
+                bool allDone = true;
+                for(int k=0; k<L; k++) {
+                    allDone = allDone && isDone[k];
+                }
+                if(allDone) break;
+            }
+
+            VD tx = 2. * zx.hi;
+            VD ty = 2. * zy.hi;
+            if(HasDistance) {
+                VD newDzx = tx * dzx - ty * dzy + 1.;
+                VD newDzy = tx * dzy + ty * dzx;
+                dzx = newDzx;
+                dzy = newDzy;
+            }
+            DD xy = zx * zy;
+            zx = zx * zx - zy * zy + cx;
+            zy = xy.twice() + cy;
+
+            VD r2 = zx.hi * zx.hi + zy.hi * zy.hi;
+            VI exits = ~hasExited & (r2 > rcut2);
+            n = (exits & (VI() + i)) | (~exits & n);
+            exitR2 = (VD)((exits & (VI)r2) | (~exits & (VI)exitR2));
+            hasExited |= exits;
+
+            if(HasDistance) {
+                VD dr2 = dzx * dzx + dzy * dzy;
+                VI exitsDist = ~hasExitedDist & (dr2 > rcutDist * rcutDist);
+                if(i > niterDist) exitsDist = ~hasExitedDist;
+                distR2 = (VD)((exitsDist & (VI)r2) | (~exitsDist & (VI)distR2));
+                distDr2 = (VD)((exitsDist & (VI)dr2) | (~exitsDist & (VI)distDr2));
+                hasExitedDist |= exitsDist;
+                hasDistance |= exitsDist;
+            }
+
+            VD dx = (zx - zSavedx).hi;
+            VD dy = (zy - zSavedy).hi;
+            VI isPeriodic = ~hasExited & (dx * dx + dy * dy < params.periodicityTolerance2);
+            skipped += isPeriodic & (VI() + (params.precision - i - 1));
+            hasExited |= isPeriodic;
+            hasExitedDist |= isPeriodic;
+            if(i == nextSave) {
+                zSavedx = zx;
+                zSavedy = zy;
+                nextSave *= 2;
+            }
+        }
+
+        for(int k=0; k<L && first + k < count; k++) {
+            stats.skippedIterations += skipped[k];
+            MandelbrotSet::MandelbrotPoint &p = out[first + k];
+            p.n = n[k];
+            p.r = p.n >= 0 && (params.fields & MandelbrotSet::RadiusField) ? sqrt(exitR2[k]) : 0;
+            p.de = 0;
+            if(hasDistance[k]) {
+                double r = sqrt(distR2[k]);
+                p.de = r * log(r)/sqrt(distDr2[k]);
+            }
+        }
+    }
+}
+
+}
+
+__attribute__((target("avx2")))
+void MandelbrotSimdKernel::batchTestAvx2(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                         const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    if(params.fields & MandelbrotSet::DistanceField) {
+        batchTestOrder2<Double4, 4, true>(x0, y0, count, out, params, stats);
+    }else{
+        batchTestOrder2<Double4, 4, false>(x0, y0, count, out, params, stats);
+    }
+}
+
+__attribute__((target("avx512f")))
+void MandelbrotSimdKernel::batchTestAvx512(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                           const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    if(params.fields & MandelbrotSet::DistanceField) {
+        batchTestOrder2<Double8, 8, true>(x0, y0, count, out, params, stats);
+    }else{
+        batchTestOrder2<Double8, 8, false>(x0, y0, count, out, params, stats);
+    }
+}
+
+__attribute__((target("avx2")))
+void MandelbrotSimdKernel::batchTestFloatAvx2(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                              const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    if(params.fields & MandelbrotSet::DistanceField) {
+        batchTestOrder2<Float8, 8, true>(x0, y0, count, out, params, stats);
+    }else{
+        batchTestOrder2<Float8, 8, false>(x0, y0, count, out, params, stats);
+    }
+}
+
+__attribute__((target("avx512f")))
+void MandelbrotSimdKernel::batchTestFloatAvx512(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                                const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    if(params.fields & MandelbrotSet::DistanceField) {
+        batchTestOrder2<Float16, 16, true>(x0, y0, count, out, params, stats);
+    }else{
+        batchTestOrder2<Float16, 16, false>(x0, y0, count, out, params, stats);
+    }
+}
+
+__attribute__((target("avx2")))
+void MandelbrotSimdKernel::batchTestDoubleDoubleAvx2(const double *x0Hi, const double *x0Lo,
+                                                     const double *y0Hi, const double *y0Lo,
+                                                     int count, MandelbrotPoint *out,
+                                                     const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    if(params.fields & MandelbrotSet::DistanceField) {
+        batchTestDoubleDoubleOrder2<Double4, 4, true>(x0Hi, x0Lo, y0Hi, y0Lo, count, out, params, stats);
+    }else{
+        batchTestDoubleDoubleOrder2<Double4, 4, false>(x0Hi, x0Lo, y0Hi, y0Lo, count, out, params, stats);
+    }
+}
+
+__attribute__((target("avx512f")))
+void MandelbrotSimdKernel::batchTestDoubleDoubleAvx512(const double *x0Hi, const double *x0Lo,
+                                                       const double *y0Hi, const double *y0Lo,
+                                                       int count, MandelbrotPoint *out,
+                                                       const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    if(params.fields & MandelbrotSet::DistanceField) {
+        batchTestDoubleDoubleOrder2<Double8, 8, true>(x0Hi, x0Lo, y0Hi, y0Lo, count, out, params, stats);
+    }else{
+        batchTestDoubleDoubleOrder2<Double8, 8, false>(x0Hi, x0Lo, y0Hi, y0Lo, count, out, params, stats);
+    }
+}
+
+MandelbrotSimdKernel::InstructionSet MandelbrotSimdKernel::getInstructionSet()
+{
+    static InstructionSet instructionSet = __builtin_cpu_supports("avx512f") ? AVX512 :
+                                           __builtin_cpu_supports("avx2") ? AVX2 : Scalar;
+    return instructionSet;
+}
+
+#else
+
+void MandelbrotSimdKernel::batchTestAvx2(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                         const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    for(int k=0; k<count; k++) {
+        out[k] = MandelbrotKernel::integerTest<2>(x0[k], y0[k], params, stats);
+    }
+}
+
+void MandelbrotSimdKernel::batchTestAvx512(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                           const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    batchTestAvx2(x0, y0, count, out, params, stats);
+}
+
+void MandelbrotSimdKernel::batchTestFloatAvx2(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                              const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    batchTestAvx2(x0, y0, count, out, params, stats);
+}
+
+void MandelbrotSimdKernel::batchTestFloatAvx512(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                                const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    batchTestAvx2(x0, y0, count, out, params, stats);
+}
+
+void MandelbrotSimdKernel::batchTestDoubleDoubleAvx2(const double *x0Hi, const double *x0Lo,
+                                                     const double *y0Hi, const double *y0Lo,
+                                                     int count, MandelbrotPoint *out,
+                                                     const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    for(int k=0; k<count; k++) {
+        out[k] = MandelbrotKernel::doubleDoubleTest(MandelbrotKernel::DoubleDouble(x0Hi[k], x0Lo[k]),
+                                                    MandelbrotKernel::DoubleDouble(y0Hi[k], y0Lo[k]), params, stats);
+    }
+}
+
+void MandelbrotSimdKernel::batchTestDoubleDoubleAvx512(const double *x0Hi, const double *x0Lo,
+                                                       const double *y0Hi, const double *y0Lo,
+                                                       int count, MandelbrotPoint *out,
+                                                       const MandelbrotKernelParams &params, MandelbrotKernelStats &stats)
+{
+    batchTestDoubleDoubleAvx2(x0Hi, x0Lo, y0Hi, y0Lo, count, out, params, stats);
+}
+
+MandelbrotSimdKernel::InstructionSet MandelbrotSimdKernel::getInstructionSet()
+{
+    return Scalar;
+}
+
+#endif
+
+/**
+ * @param order Order of the set.
+ * @return The test matching the widest available instruction set,
+ * a null pointer if the order is not 2 or if no vector instructions are available.
+ */
+MandelbrotSimdKernel::BatchTest MandelbrotSimdKernel::select(double order)
+{
+    if(order != 2) return 0;
+
+    switch(getInstructionSet()) {
+    case AVX512: return &MandelbrotSimdKernel::batchTestAvx512;
+    case AVX2: return &MandelbrotSimdKernel::batchTestAvx2;
+    default: return 0;
+    }
+}
+
+/**
+ * @param order Order of the set.
+ * @return The single precision test matching the widest available instruction set,
+ * a null pointer if the order is not 2 or if no vector instructions are available.
+ */
+MandelbrotSimdKernel::BatchTest MandelbrotSimdKernel::selectFloat(double order)
+{
+    if(order != 2) return 0;
+
+    switch(getInstructionSet()) {
+    case AVX512: return &MandelbrotSimdKernel::batchTestFloatAvx512;
+    case AVX2: return &MandelbrotSimdKernel::batchTestFloatAvx2;
+    default: return 0;
+    }
+}
+
+/**
+ * @param order Order of the set.
+ * @return The double-double test matching the widest available instruction set,
+ * a null pointer if the order is not 2 or if no vector instructions are available.
+ */
+MandelbrotSimdKernel::BatchTestDoubleDouble MandelbrotSimdKernel::selectDoubleDouble(double order)
+{
+    if(order != 2) return 0;
+
+    switch(getInstructionSet()) {
+    case AVX512: return &MandelbrotSimdKernel::batchTestDoubleDoubleAvx512;
+    case AVX2: return &MandelbrotSimdKernel::batchTestDoubleDoubleAvx2;
+    default: return 0;
+    }
+}
+
+/**
+ * @param instructionSet An instruction set.
+ * @return The name of the instruction set.
+ */
+QString MandelbrotSimdKernel::getInstructionSetName(InstructionSet instructionSet)
+{
+    switch(instructionSet) {
+    case AVX2: return "AVX2";
+    case AVX512: return "AVX-512";
+    default: return "Scalar";
+    }
+}
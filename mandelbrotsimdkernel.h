@@ -0,0 +1,98 @@
+#ifndef MANDELBROTSIMDKERNEL_H
+#define MANDELBROTSIMDKERNEL_H
+
+#include "mandelbrotkernel.h"
+
+#include <QString>
+
+/**
+ * @brief The MandelbrotSimdKernel class.
+ *
+ * This class implements vectorized convergence tests for the order 2.
+ *
+ * Several points are iterated in lockstep, one per lane of a SIMD register:
+ * 4 points with AVX2 and 8 points with AVX-512. Each lane records its escape
+ * time and distance estimate as soon as it reaches them, and the iteration
+ * stops once every lane is done. Lanes whose orbit is found to be periodic
+ * are done as well. The filled MandelbrotPoint fields are the
+ * same as the ones of MandelbrotKernel::integerTest<2>().
+ *
+ * The same test is available in single precision, for shallow zooms
+ * and previews: 8 points with AVX2 and 16 points with AVX-512.
+ * It is also available in double-double precision, for zooms past
+ * the resolution of doubles. It gives the same results as
+ * MandelbrotKernel::doubleDoubleTest().
+ *
+ * The widest instruction set supported by the CPU is detected at runtime.
+ * When none is available (or on compilers without GCC vector extensions),
+ * select() returns a null pointer and the scalar tests are used instead.
+ */
+class MandelbrotSimdKernel
+{
+public:
+
+    typedef MandelbrotSet::MandelbrotPoint MandelbrotPoint;
+
+    /** Signature of a test performed on a batch of points. */
+    typedef void (*BatchTest)(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                              const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Signature of a double-double test performed on a batch of points. */
+    typedef void (*BatchTestDoubleDouble)(const double *x0Hi, const double *x0Lo, const double *y0Hi, const double *y0Lo,
+                                          int count, MandelbrotPoint *out,
+                                          const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /**
+     * @brief The InstructionSet enum
+     *
+     * Instruction sets used by the vectorized tests.
+     */
+    enum InstructionSet {
+        Scalar,     //!< No vectorization.
+        AVX2,       //!< 4 points per batch.
+        AVX512      //!< 8 points per batch.
+    };
+
+    /** Select the vectorized test for a given order, or a null pointer if none is available. */
+    static BatchTest select(double order);
+
+    /** Select the vectorized single precision test for a given order, or a null pointer if none is available. */
+    static BatchTest selectFloat(double order);
+
+    /** Select the vectorized double-double test for a given order, or a null pointer if none is available. */
+    static BatchTestDoubleDouble selectDoubleDouble(double order);
+
+    /** Get the widest instruction set supported at runtime. */
+    static InstructionSet getInstructionSet();
+
+    /** Get the name of an instruction set. */
+    static QString getInstructionSetName(InstructionSet instructionSet);
+
+    /** Order 2 test using AVX2 instructions. */
+    static void batchTestAvx2(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                              const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Order 2 test using AVX-512 instructions. */
+    static void batchTestAvx512(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Order 2 single precision test using AVX2 instructions. */
+    static void batchTestFloatAvx2(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                   const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Order 2 single precision test using AVX-512 instructions. */
+    static void batchTestFloatAvx512(const double *x0, const double *y0, int count, MandelbrotPoint *out,
+                                     const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Order 2 double-double test using AVX2 instructions. */
+    static void batchTestDoubleDoubleAvx2(const double *x0Hi, const double *x0Lo, const double *y0Hi, const double *y0Lo,
+                                          int count, MandelbrotPoint *out,
+                                          const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+
+    /** Order 2 double-double test using AVX-512 instructions. */
+    static void batchTestDoubleDoubleAvx512(const double *x0Hi, const double *x0Lo, const double *y0Hi, const double *y0Lo,
+                                            int count, MandelbrotPoint *out,
+                                            const MandelbrotKernelParams &params, MandelbrotKernelStats &stats);
+};
+
+#endif // MANDELBROTSIMDKERNEL_H
@@ -1,5 +1,6 @@
 #include "mandelbrottheme.h"
 #include <math.h>
+#include <algorithm>
 
 #include <QDebug>
 
@@ -29,99 +30,113 @@ void MandelbrotTheme::setThemeInfo(const MandelbrotThemeInfo &themeInfo)
 void MandelbrotTheme::setMandelbrotSet(MandelbrotSet *mandelbrotSet)
 {
     m_mandelbrotSet = mandelbrotSet;
+    m_logOrder = log(m_mandelbrotSet->getOrder());
+}
 
-    if(m_themeInfo.getThemeType() == MandelbrotThemeInfo::Histogram) {
-        double max = 0;
-        m_histogram.clear();
-        const std::vector<MandelbrotSet::MandelbrotPoint> &buffer = m_mandelbrotSet->getBuffer();
-        int buffSize = buffer.size();
-        for(int i=0; i<buffSize; i++) {
-            MandelbrotSet::MandelbrotPoint p = buffer[i];
-            if(p.n >= 0) {
-                if(m_histogram.find(p.n) == m_histogram.end()) m_histogram[p.n] = 1;
-                else m_histogram[p.n] += 1;
-                if(m_histogram[p.n] > max) max = m_histogram[p.n];
-            }
-        }
+/**
+ * Each escape time gets the color at its position in the cumulative
+ * distribution of the escape times, so that the colors are spread
+ * evenly over the diverging points.
+ *
+ * @param histogram Number of points for each escape time.
+ */
+void MandelbrotTheme::setEscapeTimeHistogram(const std::vector<int> &histogram)
+{
+    qint64 total = 0;
+    for(unsigned int n=0; n<histogram.size(); n++) {
+        total += histogram[n];
+    }
 
-        for(std::map<int, double>::iterator itr=m_histogram.begin();
-            itr!=m_histogram.end(); itr++) {
-            itr->second /= max;
-        }
+    int nColors = m_paletteRgb.size();
+    m_histogramRgb.resize(histogram.size());
+    qint64 cumulated = 0;
+    for(unsigned int n=0; n<histogram.size(); n++) {
+        cumulated += histogram[n];
+        double cdf = total > 0 ? (double)cumulated / total : 0;
+        m_histogramRgb[n] = getPaletteRgb(std::max(0, (int)(cdf * (nColors - 1))));
     }
 }
 
-QColor MandelbrotTheme::getColor(const MandelbrotSet::MandelbrotPoint &p)
+QColor MandelbrotTheme::getColor(const MandelbrotSet::MandelbrotPoint &p) const
+{
+    return QColor(getRgb(p));
+}
+
+/**
+ * The colors are looked up in flat tables of packed colors built beforehand,
+ * so that this can be called concurrently for all the pixels of an image.
+ *
+ * @param p Result of the convergence test.
+ * @return The color of the point.
+ */
+QRgb MandelbrotTheme::getRgb(const MandelbrotSet::MandelbrotPoint &p) const
 {
 
     switch(m_themeInfo.getThemeType()) {
     case MandelbrotThemeInfo::BiColor:
         if(p.n < 0) {
-            return m_themeInfo.getConvergedColor();
+            return m_convergedRgb;
         }else{
-            return m_themeInfo.getDivergedColor();
+            return m_divergedRgb;
         }
     case MandelbrotThemeInfo::EscapeTime:
         if(p.n < 0) {
-            return m_themeInfo.getConvergedColor();
+            return m_convergedRgb;
         }else{
-            return getPaletteInvertedColor(p.n);
+            return getPaletteInvertedRgb(p.n);
         }
     case MandelbrotThemeInfo::Distance:
         if(p.n < 0) {
-            return m_themeInfo.getConvergedColor();
+            return m_convergedRgb;
         }else{
             double n = m_palette.size()*(p.de)/4;
-            const QColor &color1 = getPaletteColor((int)floor(n));
-            const QColor &color2 = getPaletteColor((int)floor(n)+1);
-
-            double r1 = color1.red();
-            double g1 = color1.green();
-            double b1 = color1.blue();
-
-            double r2 = color2.red();
-            double g2 = color2.green();
-            double b2 = color2.blue();
-
-            double r = r1 + (r2 - r1) * (n - floor(n));
-            double g = g1 + (g2 - g1) * (n - floor(n));
-            double b = b1 + (b2 - b1) * (n - floor(n));
-
-            return QColor(r, g, b);
+            return interpolate(getPaletteRgb((int)floor(n)), getPaletteRgb((int)floor(n)+1), n - floor(n));
         }
     case MandelbrotThemeInfo::Continuous:
         if(p.n < 0) {
-            return m_themeInfo.getConvergedColor();
+            return m_convergedRgb;
         }else{
-            double n = p.n + 1 - log( log(p.r) / log(2) ) / log(m_mandelbrotSet->getOrder());
-            const QColor &color1 = getPaletteInvertedColor(floor(n));
-            const QColor &color2 = getPaletteInvertedColor(floor(n)+1);
-
-            double r1 = color1.red();
-            double g1 = color1.green();
-            double b1 = color1.blue();
-
-            double r2 = color2.red();
-            double g2 = color2.green();
-            double b2 = color2.blue();
-
-            double r = r1 + (r2 - r1) * (n - floor(n));
-            double g = g1 + (g2 - g1) * (n - floor(n));
-            double b = b1 + (b2 - b1) * (n - floor(n));
-
-            return QColor(r, g, b);
+            double n = p.n + 1 - log( log(p.r) / log(2) ) / m_logOrder;
+            return interpolate(getPaletteInvertedRgb(floor(n)), getPaletteInvertedRgb(floor(n)+1), n - floor(n));
         }
     case MandelbrotThemeInfo::Histogram:
         if(p.n < 0) {
-            return m_themeInfo.getConvergedColor();
+            return m_convergedRgb;
+        }else if(p.n < (int)m_histogramRgb.size()) {
+            return m_histogramRgb[p.n];
+        }else if(!m_histogramRgb.empty()) {
+            return m_histogramRgb.back();
         }else{
-            return getPaletteColor((int)(99*m_histogram[p.n]));
+            return getPaletteRgb(0);
         }
     default:
-        return QColor(0,0,0);
+        return qRgb(0,0,0);
     }
 }
 
+/**
+ * @param color1 Color for f = 0.
+ * @param color2 Color for f = 1.
+ * @param f Position between the two colors.
+ * @return The interpolated color, each component being truncated.
+ */
+QRgb MandelbrotTheme::interpolate(QRgb color1, QRgb color2, double f)
+{
+    double r1 = qRed(color1);
+    double g1 = qGreen(color1);
+    double b1 = qBlue(color1);
+
+    double r2 = qRed(color2);
+    double g2 = qGreen(color2);
+    double b2 = qBlue(color2);
+
+    double r = r1 + (r2 - r1) * f;
+    double g = g1 + (g2 - g1) * f;
+    double b = b1 + (b2 - b1) * f;
+
+    return qRgb((int)r, (int)g, (int)b);
+}
+
 const QColor &MandelbrotTheme::getPaletteColor(int i) const
 {
     static QColor defaultColor = QColor(0,0,0);
@@ -140,6 +155,22 @@ const QColor &MandelbrotTheme::getPaletteInvertedColor(int i) const
     }
     return m_palette[m_palette.size() - (i % m_palette.size()) - 1];
 }
+
+QRgb MandelbrotTheme::getPaletteRgb(int i) const
+{
+    if(m_paletteRgb.size() == 0) {
+        return qRgb(0,0,0);
+    }
+    return m_paletteRgb[i % m_paletteRgb.size()];
+}
+
+QRgb MandelbrotTheme::getPaletteInvertedRgb(int i) const
+{
+    if(m_paletteRgb.size() == 0) {
+        return qRgb(0,0,0);
+    }
+    return m_paletteRgb[m_paletteRgb.size() - (i % m_paletteRgb.size()) - 1];
+}
 void MandelbrotTheme::initPalette()
 {
 
@@ -218,5 +249,12 @@ void MandelbrotTheme::initPalette()
     default:
         break;
     }
+
+    m_paletteRgb.resize(m_palette.size());
+    for(unsigned int i=0; i<m_palette.size(); i++) {
+        m_paletteRgb[i] = m_palette[i].rgb();
+    }
+    m_convergedRgb = m_themeInfo.getConvergedColor().rgb();
+    m_divergedRgb = m_themeInfo.getDivergedColor().rgb();
 }
 
@@ -31,8 +31,14 @@ public:
     /** Set a pointer to the set being drawn. */
     void setMandelbrotSet(MandelbrotSet *mandelbrotSet);
 
+    /** Set the number of points for each escape time of the buffer being drawn, used by the histogram theme. */
+    void setEscapeTimeHistogram(const std::vector<int> &histogram);
+
     /** Get a color for a given point based on the result of the convergence test. */
-    QColor getColor(const MandelbrotSet::MandelbrotPoint &p);
+    QColor getColor(const MandelbrotSet::MandelbrotPoint &p) const;
+
+    /** Get a packed color for a given point based on the result of the convergence test. */
+    QRgb getRgb(const MandelbrotSet::MandelbrotPoint &p) const;
 
     /** Get a color from the color palette. */
     const QColor &getPaletteColor(int i) const;
@@ -45,11 +51,24 @@ protected:
     /** Construct a palette based on the theme settings. */
     void initPalette();
 
+    /** Get a packed color from the color palette. */
+    QRgb getPaletteRgb(int i) const;
+
+    /** Get a packed color from the inverted color palette. */
+    QRgb getPaletteInvertedRgb(int i) const;
+
+    /** Interpolate between two packed colors. */
+    static QRgb interpolate(QRgb color1, QRgb color2, double f);
+
     MandelbrotThemeInfo m_themeInfo; //!< Theme settings.
     std::vector<QColor> m_palette; //!< Color palette.
-    std::map<int, double> m_histogram; //!< Escape time histogram.
+    std::vector<QRgb> m_paletteRgb; //!< Color palette as packed colors.
+    QRgb m_convergedRgb; //!< Color of the converged points as a packed color.
+    QRgb m_divergedRgb; //!< Color of the diverged points as a packed color.
+    std::vector<QRgb> m_histogramRgb; //!< Packed color of each escape time for the histogram theme.
 
     MandelbrotSet *m_mandelbrotSet; //!< The mandelbrot set being drawn.
+    double m_logOrder; //!< Logarithm of the order of the set being drawn.
 };
 
 #endif // MANDELBROTTHEME_H
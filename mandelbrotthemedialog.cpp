@@ -113,6 +113,10 @@ void MandelbrotThemeDialog::showHideWidgets()
 
     MandelbrotThemeInfo themeInfo = m_themeManager.getCurrentThemeInfo();
 
+    bool isFillingAllowed = MandelbrotThemeInfo::isFillingAllowed(themeInfo.getThemeType());
+    ui->renderingLabel->setEnabled(isFillingAllowed);
+    ui->renderingCombo->setEnabled(isFillingAllowed);
+
     switch(themeInfo.getThemeType()) {
     case MandelbrotThemeInfo::BiColor:
         ui->convergedColorButton->show();
@@ -178,6 +182,14 @@ void MandelbrotThemeDialog::loadThemeInfo()
     ui->typeCombo->addItems(themeInfo.getThemeTypes());
     ui->typeCombo->setCurrentText(themeInfo.getThemeTypeName(themeInfo.getThemeType()));
     ui->typeCombo->blockSignals(false);
+
+    ui->renderingCombo->blockSignals(true);
+    ui->renderingCombo->clear();
+    ui->renderingCombo->addItems(themeInfo.getRenderingMethods());
+    ui->renderingCombo->setCurrentText(themeInfo.getRenderingMethodName(
+                                           themeInfo.getRenderingMethod()));
+    ui->renderingCombo->blockSignals(false);
+
     ui->convergedColorButton->setIcon(getColorButtonIcon(themeInfo.getConvergedColor()));
     ui->divergedColorButton->setIcon(getColorButtonIcon(themeInfo.getDivergedColor()));
 
@@ -222,6 +234,13 @@ void MandelbrotThemeDialog::on_typeCombo_currentTextChanged(const QString &arg1)
     showHideWidgets();
 }
 
+void MandelbrotThemeDialog::on_renderingCombo_currentTextChanged(const QString &arg1)
+{
+    MandelbrotThemeInfo themeInfo = m_themeManager.getCurrentTheme().getThemeInfo();
+    themeInfo.setRenderingMethod(MandelbrotThemeInfo::getRenderingMethod(arg1));
+    m_themeManager.getCurrentTheme().setThemeInfo(themeInfo);
+}
+
 void MandelbrotThemeDialog::on_convergedColorButton_clicked()
 {
     MandelbrotThemeInfo themeInfo = m_themeManager.getCurrentTheme().getThemeInfo();
@@ -33,6 +33,8 @@ private slots:
 
     void on_typeCombo_currentTextChanged(const QString &arg1);
 
+    void on_renderingCombo_currentTextChanged(const QString &arg1);
+
     void on_convergedColorButton_clicked();
 
     void on_divergedColorButton_clicked();
@@ -14,11 +14,13 @@ MandelbrotThemeInfo::MandelbrotThemeInfo()
     m_convergedColor = QColor(0,0,0);
     m_divergedColor = QColor(255,255,255);
     m_randomSeed = 1234;
+    m_renderingMethod = FullRendering;
 
 }
 
 QStringList MandelbrotThemeInfo::s_themeTypes = QStringList();
 QStringList MandelbrotThemeInfo::s_paletteTypes = QStringList();
+QStringList MandelbrotThemeInfo::s_renderingMethods = QStringList();
 
 const QString &MandelbrotThemeInfo::getName() const
 {
@@ -65,6 +67,11 @@ int MandelbrotThemeInfo::getRandomSeed() const
     return m_randomSeed;
 }
 
+MandelbrotThemeInfo::RenderingMethod MandelbrotThemeInfo::getRenderingMethod() const
+{
+    return m_renderingMethod;
+}
+
 void MandelbrotThemeInfo::setName(const QString &name)
 {
     m_name = name;
@@ -110,6 +117,11 @@ void MandelbrotThemeInfo::setRandomSeed(int seed)
     m_randomSeed = seed;
 }
 
+void MandelbrotThemeInfo::setRenderingMethod(MandelbrotThemeInfo::RenderingMethod method)
+{
+    m_renderingMethod = method;
+}
+
 QStringList MandelbrotThemeInfo::getThemeTypes()
 {
     if(s_themeTypes.empty()) {
@@ -182,3 +194,53 @@ MandelbrotThemeInfo::PaletteType MandelbrotThemeInfo::getPaletteType(QString nam
     if(name == "Rainbow") return Rainbow;
     return NoPalette;
 }
+
+QStringList MandelbrotThemeInfo::getRenderingMethods()
+{
+    if(s_renderingMethods.empty()) {
+        s_renderingMethods.push_back(getRenderingMethodName(FullRendering));
+        s_renderingMethods.push_back(getRenderingMethodName(RectangleSubdivision));
+        s_renderingMethods.push_back(getRenderingMethodName(BoundaryTracing));
+    }
+    return s_renderingMethods;
+}
+
+QString MandelbrotThemeInfo::getRenderingMethodName(RenderingMethod method)
+{
+    switch (method) {
+    case FullRendering: return "Full";
+    case RectangleSubdivision: return "Rectangle Subdivision";
+    case BoundaryTracing: return "Boundary Tracing";
+    case NoRenderingMethod: return "NoRenderingMethod";
+    }
+    return "Unknown";
+}
+
+MandelbrotThemeInfo::RenderingMethod MandelbrotThemeInfo::getRenderingMethod(QString name)
+{
+    if(name == "Full") return FullRendering;
+    if(name == "Rectangle Subdivision") return RectangleSubdivision;
+    if(name == "Boundary Tracing") return BoundaryTracing;
+    return NoRenderingMethod;
+}
+
+/**
+ * Rendering methods other than FullRendering fill whole areas with the
+ * result of the tests performed on their boundary. This is only valid for
+ * themes relying on the escape time alone: the Distance and Continuous themes
+ * need a radius and a distance estimate for every single pixel.
+ *
+ * @param type A theme type.
+ * @return true if the theme type can be used with a filling rendering method.
+ */
+bool MandelbrotThemeInfo::isFillingAllowed(ThemeType type)
+{
+    switch(type) {
+    case BiColor:
+    case EscapeTime:
+    case Histogram:
+        return true;
+    default:
+        return false;
+    }
+}
@@ -45,6 +45,18 @@ public:
         NoPalette       //!< Not a valid palette.
     };
 
+    /**
+     * @brief The RenderingMethod enum
+     *
+     * Various ways of computing the set before coloring it.
+     */
+    enum RenderingMethod {
+        FullRendering,          //!< Perform a convergence test for every pixel.
+        RectangleSubdivision,   //!< Fill rectangles with a uniform border without testing their inside (Mariani-Silver).
+        BoundaryTracing,        //!< Only test the contours of the regions of same escape time, then flood-fill them.
+        NoRenderingMethod       //!< Not a valid rendering method.
+    };
+
     const QString &getName() const;
     ThemeType getThemeType() const;
     PaletteType getPaletteType() const;
@@ -54,6 +66,7 @@ public:
     const QColor &getConvergedColor() const;
     const QColor &getDivergedColor() const;
     int getRandomSeed() const;
+    RenderingMethod getRenderingMethod() const;
 
     void setName(const QString &name);
     void setThemeType(ThemeType type);
@@ -64,6 +77,7 @@ public:
     void setConvergedColor(const QColor &c);
     void setDivergedColor(const QColor &c);
     void setRandomSeed(int seed);
+    void setRenderingMethod(RenderingMethod method);
 
     static QStringList getThemeTypes();
     static QString getThemeTypeName(ThemeType type);
@@ -73,6 +87,11 @@ public:
     static QString getPaletteTypeName(PaletteType type);
     static PaletteType getPaletteType(QString name);
 
+    static QStringList getRenderingMethods();
+    static QString getRenderingMethodName(RenderingMethod method);
+    static RenderingMethod getRenderingMethod(QString name);
+    static bool isFillingAllowed(ThemeType type);
+
 protected:
 
     QString m_name;
@@ -84,9 +103,11 @@ protected:
     QColor m_convergedColor;
     QColor m_divergedColor;
     int m_randomSeed;
+    RenderingMethod m_renderingMethod;
 
     static QStringList s_themeTypes;
     static QStringList s_paletteTypes;
+    static QStringList s_renderingMethods;
 
 };
 
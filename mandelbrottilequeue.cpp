@@ -0,0 +1,50 @@
+#include "mandelbrottilequeue.h"
+
+#include <algorithm>
+
+MandelbrotTileQueue::MandelbrotTileQueue() :
+    m_head(0)
+{
+}
+
+MandelbrotTileQueue::~MandelbrotTileQueue()
+{
+    takeAll();
+}
+
+/**
+ * @param tileImage Completed tile.
+ * @return true if the queue was empty, i.e. the consumer has to be notified.
+ */
+bool MandelbrotTileQueue::push(const MandelbrotTileImage &tileImage)
+{
+    Node *node = new Node;
+    node->tileImage = tileImage;
+
+    // The release ordering publishes the tile along with the node.
+    Node *head;
+    do {
+        head = m_head.loadAcquire();
+        node->next = head;
+    } while(!m_head.testAndSetRelease(head, node));
+
+    return head == 0;
+}
+
+/**
+ * @return The tiles pushed since the last call, the oldest first.
+ */
+std::vector<MandelbrotTileImage> MandelbrotTileQueue::takeAll()
+{
+    Node *node = m_head.fetchAndStoreAcquire(0);
+
+    std::vector<MandelbrotTileImage> tileImages;
+    while(node) {
+        tileImages.push_back(node->tileImage);
+        Node *next = node->next;
+        delete node;
+        node = next;
+    }
+    std::reverse(tileImages.begin(), tileImages.end());
+    return tileImages;
+}
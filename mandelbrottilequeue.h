@@ -0,0 +1,72 @@
+#ifndef MANDELBROTTILEQUEUE_H
+#define MANDELBROTTILEQUEUE_H
+
+#include <QAtomicPointer>
+#include <QImage>
+
+#include <vector>
+
+#include "mandelbrottilescheduler.h"
+#include "mandelbrotviewport.h"
+
+/**
+ * @brief The MandelbrotTileImage structure.
+ *
+ * The colors of a completed tile, to be copied into the image being displayed.
+ */
+struct MandelbrotTileImage {
+    MandelbrotTile tile; //!< Position of the tile in the image.
+    QImage image; //!< Colors of the tile, with the size of the tile.
+    MandelbrotViewport viewport; //!< Region of the complex plane mapped to the whole image.
+};
+
+/**
+ * @brief The MandelbrotTileQueue class.
+ *
+ * Lock-free queue carrying the completed tiles from the workers to the thread
+ * that displays them.
+ *
+ * Any number of workers push tiles concurrently onto a linked list with a
+ * compare-and-swap on its head. The consumer takes the whole list at once by
+ * exchanging the head with null, which is immune to the ABA problem of
+ * popping nodes one by one, and restores the order of arrival. A push reports
+ * whether the queue was empty, so that the consumer is notified once per
+ * batch instead of once per tile.
+ */
+class MandelbrotTileQueue
+{
+public:
+
+    /** Constructor: an empty queue. */
+    MandelbrotTileQueue();
+
+    /** Destructor: drop the tiles not taken. */
+    ~MandelbrotTileQueue();
+
+    /** Add a tile, from any thread. */
+    bool push(const MandelbrotTileImage &tileImage);
+
+    /** Take all the tiles, in the order they were pushed. */
+    std::vector<MandelbrotTileImage> takeAll();
+
+protected:
+
+    /**
+     * @brief The Node structure.
+     *
+     * Element of the linked list, from the last pushed tile to the first one.
+     */
+    struct Node {
+        MandelbrotTileImage tileImage; //!< Tile carried by the node.
+        Node *next; //!< Tile pushed before this one, null for the first one.
+    };
+
+    QAtomicPointer<Node> m_head; //!< Last pushed tile, null if the queue is empty.
+
+private:
+
+    MandelbrotTileQueue(const MandelbrotTileQueue &);
+    MandelbrotTileQueue &operator=(const MandelbrotTileQueue &);
+};
+
+#endif // MANDELBROTTILEQUEUE_H
@@ -0,0 +1,125 @@
+#include "mandelbrottilescheduler.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+
+/**
+ * This is the greedy list scheduling: each tile, in order, goes to the worker
+ * with the lowest total so far. The shares differ by at most the cost of a tile.
+ *
+ * @param tiles The tiles to be processed.
+ * @param costs Predicted cost of each tile, in any unit.
+ * @param nWorkers Number of workers.
+ */
+MandelbrotTileScheduler::MandelbrotTileScheduler(const std::vector<MandelbrotTile> &tiles,
+                                                 const std::vector<double> &costs, int nWorkers) :
+    m_queues(nWorkers < 1 ? 1 : nWorkers),
+    m_predictedCosts(m_queues.size(), 0)
+{
+    for(size_t k=0; k<tiles.size(); k++) {
+        int worker = std::min_element(m_predictedCosts.begin(), m_predictedCosts.end()) - m_predictedCosts.begin();
+        m_queues[worker].tiles.push_back(tiles[k]);
+        m_predictedCosts[worker] += costs[k];
+    }
+}
+
+/**
+ * @param worker Index of the worker asking for a tile.
+ * @param tile Filled with the next tile to be processed.
+ * @return false if there is no more tiles to process.
+ */
+bool MandelbrotTileScheduler::next(int worker, MandelbrotTile &tile)
+{
+    WorkerQueue &queue = m_queues[worker];
+    {
+        QMutexLocker locker(&queue.mutex);
+        if(!queue.tiles.empty()) {
+            tile = queue.tiles.front();
+            queue.tiles.pop_front();
+            return true;
+        }
+    }
+    return steal(worker, tile);
+}
+
+int MandelbrotTileScheduler::getNWorkers() const
+{
+    return m_queues.size();
+}
+
+/**
+ * @param worker Index of the worker.
+ * @return The total cost of the tiles initially queued for the worker.
+ */
+double MandelbrotTileScheduler::getPredictedCost(int worker) const
+{
+    return m_predictedCosts[worker];
+}
+
+/**
+ * Tiles are ordered column by column, each tile covering at most
+ * tileSize x tileSize pixels.
+ *
+ * @param width Width of the image in pixels.
+ * @param height Height of the image in pixels.
+ * @param tileSize Size of the tiles in pixels.
+ * @return The list of tiles.
+ */
+std::vector<MandelbrotTile> MandelbrotTileScheduler::makeTiles(int width, int height, int tileSize)
+{
+    std::vector<MandelbrotTile> tiles;
+    for(int x0=0; x0<width; x0+=tileSize) {
+        for(int y0=0; y0<height; y0+=tileSize) {
+            MandelbrotTile tile;
+            tile.x0 = x0;
+            tile.y0 = y0;
+            tile.x1 = std::min(x0 + tileSize, width);
+            tile.y1 = std::min(y0 + tileSize, height);
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+/**
+ * The distance is measured from the center of the tiles. Tiles at the
+ * same distance keep their order, so that the result is deterministic.
+ *
+ * @param tiles The tiles to be sorted.
+ * @param x Column of the point, in pixels.
+ * @param y Row of the point, in pixels.
+ */
+void MandelbrotTileScheduler::sortByDistance(std::vector<MandelbrotTile> &tiles, double x, double y)
+{
+    auto distance2 = [x, y](const MandelbrotTile &tile) {
+        double dx = (tile.x0 + tile.x1) / 2.0 - x;
+        double dy = (tile.y0 + tile.y1) / 2.0 - y;
+        return dx*dx + dy*dy;
+    };
+    std::stable_sort(tiles.begin(), tiles.end(), [&distance2](const MandelbrotTile &a, const MandelbrotTile &b) {
+        return distance2(a) < distance2(b);
+    });
+}
+
+/**
+ * Victims are visited in a round robin starting with the worker's neighbour.
+ *
+ * @param worker Index of the worker stealing.
+ * @param tile Filled with the stolen tile.
+ * @return false if all the queues are empty.
+ */
+bool MandelbrotTileScheduler::steal(int worker, MandelbrotTile &tile)
+{
+    int nQueues = m_queues.size();
+    for(int k=1; k<nQueues; k++) {
+        WorkerQueue &victim = m_queues[(worker + k) % nQueues];
+        QMutexLocker locker(&victim.mutex);
+        if(!victim.tiles.empty()) {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,89 @@
+#ifndef MANDELBROTTILESCHEDULER_H
+#define MANDELBROTTILESCHEDULER_H
+
+#include <QMutex>
+#include <QtGlobal>
+
+#include <deque>
+#include <vector>
+
+/**
+ * @brief The MandelbrotTile structure.
+ *
+ * A rectangular block of pixels: columns [x0, x1) and rows [y0, y1).
+ */
+struct MandelbrotTile {
+    int x0; //!< First column of the tile.
+    int y0; //!< First row of the tile.
+    int x1; //!< One past the last column of the tile.
+    int y1; //!< One past the last row of the tile.
+};
+
+/**
+ * @brief The MandelbrotWorkerStats structure.
+ *
+ * Activity of a worker during a calculation, to check the balance of the load.
+ */
+struct MandelbrotWorkerStats {
+    qint64 busyTime; //!< Time spent processing tiles, in nanoseconds.
+    qint64 idleTime; //!< Time spent waiting for the other workers to finish a pass, in nanoseconds.
+    int nTiles; //!< Number of tiles processed.
+    double predictedCost; //!< Cost of the tiles initially handed to the worker, as estimated.
+};
+
+/**
+ * @brief The MandelbrotTileScheduler class.
+ *
+ * Distributes tiles among a fixed number of workers using work stealing.
+ *
+ * The tiles are dealt in turn to the worker with the lowest total predicted
+ * cost, so that the shares are of equal cost instead of equal size. Each worker
+ * owns a queue holding its share, in the order of the tiles: the tiles sorted
+ * by sortByDistance() are processed from the nearest to the farthest.
+ *
+ * A worker takes tiles from the front of its own queue. Once it runs dry, it steals
+ * the farthest tiles from the back of the other queues, which only corrects the
+ * errors of the estimate.
+ */
+class MandelbrotTileScheduler
+{
+public:
+
+    /** Constructor: shares of equal predicted cost. */
+    MandelbrotTileScheduler(const std::vector<MandelbrotTile> &tiles, const std::vector<double> &costs, int nWorkers);
+
+    /** Get the next tile to be processed by a given worker. */
+    bool next(int worker, MandelbrotTile &tile);
+
+    /** Get the number of workers. */
+    int getNWorkers() const;
+
+    /** Get the predicted cost of the share initially handed to a worker. */
+    double getPredictedCost(int worker) const;
+
+    /** Split an image into tiles of a given size. */
+    static std::vector<MandelbrotTile> makeTiles(int width, int height, int tileSize);
+
+    /** Sort tiles by distance from a point, the nearest first. */
+    static void sortByDistance(std::vector<MandelbrotTile> &tiles, double x, double y);
+
+protected:
+
+    /**
+     * @brief The WorkerQueue structure.
+     *
+     * Queue of tiles owned by a single worker.
+     */
+    struct WorkerQueue {
+        QMutex mutex; //!< Protects the tiles queue.
+        std::deque<MandelbrotTile> tiles; //!< Tiles yet to be processed.
+    };
+
+    /** Take a tile from the back of another worker's queue. */
+    bool steal(int worker, MandelbrotTile &tile);
+
+    std::vector<WorkerQueue> m_queues; //!< One queue per worker.
+    std::vector<double> m_predictedCosts; //!< Predicted cost of the share of each worker.
+};
+
+#endif // MANDELBROTTILESCHEDULER_H
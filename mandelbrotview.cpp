@@ -1,11 +1,13 @@
 #include "mandelbrotview.h"
 #include "ui_mandelbrotview.h"
 #include "mandelbrotset.h"
+#include "mandelbrotrenderengine.h"
 
 #include <math.h>
 
 #include <QPainter>
 #include <QMouseEvent>
+#include <QWheelEvent>
 
 #include <QDebug>
 
@@ -20,10 +22,23 @@ MandelbrotView::MandelbrotView(QWidget *parent) :
 
     ui->centralView->setCursor(QCursor(QPixmap(":/cursor/rc/CrossCursor.png"), 7, 7));
 
-    m_mandelbrotSet = new MandelbrotSet();
-    m_isBusy = false;
+    m_renderEngine = new MandelbrotRenderEngine(this);
+    m_viewport = m_renderEngine->getMandelbrotSet()->getViewport();
+    m_renderEngine->getMandelbrotSet()->setTileStreaming(true);
+
+    // The coarse passes of a calculation are displayed as soon as they are available,
+    // then the tiles of the last pass are copied over them as they are completed.
+    connect(m_renderEngine, SIGNAL(partialImageReady(QImage,MandelbrotViewport)),
+            this, SLOT(showImage(QImage,MandelbrotViewport)));
+    connect(m_renderEngine, SIGNAL(tilesReady()), this, SLOT(showTiles()));
+    connect(m_renderEngine, SIGNAL(imageReady(QImage,MandelbrotRenderResult)),
+            this, SLOT(showCompleteImage(QImage,MandelbrotRenderResult)));
+    connect(m_renderEngine, SIGNAL(renderCanceled()),
+            this, SLOT(restoreImage()));
 
     m_isPressed = false;
+    m_isPanMode = false;
+    m_focus = QPointF(0.5, 0.5);
 
 }
 
@@ -34,7 +49,12 @@ MandelbrotView::~MandelbrotView()
 
 MandelbrotSet *MandelbrotView::getMandelbrotSet()
 {
-    return m_mandelbrotSet;
+    return m_renderEngine->getMandelbrotSet();
+}
+
+MandelbrotRenderEngine *MandelbrotView::getRenderEngine()
+{
+    return m_renderEngine;
 }
 
 QPixmap MandelbrotView::getPixmap()
@@ -42,18 +62,31 @@ QPixmap MandelbrotView::getPixmap()
     return m_pixmap;
 }
 
-
-void MandelbrotView::update(double xmin, double xmax, double ymin, double ymax)
+/**
+ * @return The region of the complex plane shown by the image displayed.
+ */
+MandelbrotViewport MandelbrotView::getViewport() const
 {
-    if(m_isBusy) return;
+    return m_viewport;
+}
 
-    m_isBusy = true;
 
+/**
+ * The image fits the view, with the aspect ratio of the region.
+ * The call does not block: the image is computed by the render engine,
+ * starting from the cursor, or from the center after a zoom on a selection.
+ * A preview is rendered quickly at deep zooms, then at full precision.
+ *
+ * @param viewport Region of the complex plane to be rendered.
+ * @param isPreview true for a quick preview of an interaction. Default is false.
+ */
+void MandelbrotView::update(const MandelbrotViewport &viewport, bool isPreview)
+{
     QSize viewSize = ui->centralView->size();
     QSize pixmapSize;
 
     double viewAspectRatio = (double)(viewSize.width())/viewSize.height();
-    double realAspectRatio = (xmax - xmin) / (ymax - ymin);
+    double realAspectRatio = viewport.getWidth() / viewport.getHeight();
 
     if(viewAspectRatio > realAspectRatio) {
         pixmapSize.setWidth(viewSize.height() * realAspectRatio);
@@ -63,51 +96,100 @@ void MandelbrotView::update(double xmin, double xmax, double ymin, double ymax)
         pixmapSize.setHeight(viewSize.width() / realAspectRatio);
     }
 
-    QPixmap pixmap(pixmapSize);
-    pixmap.fill(QColor(0, 0, 0));
-    QImage image = pixmap.toImage();
+    MandelbrotRenderJob job = m_renderEngine->makeJob(viewport, pixmapSize, m_focus);
+    job.isFastPreview = isPreview;
+    m_renderEngine->render(job);
+}
+
+void MandelbrotView::cancel()
+{
+    m_renderEngine->cancel();
+}
 
+/**
+ * @param image Image to be displayed, possibly a coarse pass.
+ * @param viewport Region of the complex plane shown by the image.
+ */
+void MandelbrotView::showImage(const QImage &image, const MandelbrotViewport &viewport)
+{
     if(m_pixmap.isNull()) {
-        ui->horizontalAxis->setLength(pixmapSize.width());
-        ui->verticalAxis->setLength(pixmapSize.height());
-        ui->horizontalAxis->setRange(xmin, xmax);
-        ui->verticalAxis->setRange(ymin, ymax);
-        ui->horizontalAxis->setZoomFactor(m_mandelbrotSet->getZoomFactor());
-        ui->verticalAxis->setZoomFactor(m_mandelbrotSet->getZoomFactor());
+        updateAxes(image.size(), viewport);
     }
+    m_image = image;
+    m_viewport = viewport;
+    updatePixmap();
+}
 
-    bool finished = m_mandelbrotSet->fillPixmap(image, xmin, xmax, ymin, ymax);
-    if(finished) {
-        ui->horizontalAxis->setLength(pixmapSize.width());
-        ui->verticalAxis->setLength(pixmapSize.height());
-        ui->horizontalAxis->setRange(xmin, xmax);
-        ui->verticalAxis->setRange(ymin, ymax);
-        ui->horizontalAxis->setZoomFactor(m_mandelbrotSet->getZoomFactor());
-        ui->verticalAxis->setZoomFactor(m_mandelbrotSet->getZoomFactor());
-
-        pixmap = QPixmap::fromImage(image);
-        ui->centralView->setPixmap(pixmap);
-        m_pixmap = pixmap;
+/**
+ * The tiles computed for another region than the one displayed are dropped.
+ * The selection or the move being dragged is drawn again over the new tiles.
+ */
+void MandelbrotView::showTiles()
+{
+    std::vector<MandelbrotTileImage> tileImages = getMandelbrotSet()->takeCompletedTiles();
+    if(m_image.isNull()) return;
+
+    bool isUpdated = false;
+    QPainter painter(&m_image);
+    for(const MandelbrotTileImage &tileImage : tileImages) {
+        if(tileImage.viewport != m_viewport) continue;
+        painter.drawImage(tileImage.tile.x0, tileImage.tile.y0, tileImage.image);
+        isUpdated = true;
+    }
+    painter.end();
+
+    if(isUpdated) {
+        updatePixmap();
     }
-    m_isBusy = false;
+}
+
+/**
+ * @param image Complete image.
+ * @param result Description of the image, including the region of the complex plane it shows.
+ */
+void MandelbrotView::showCompleteImage(const QImage &image, const MandelbrotRenderResult &result)
+{
+    const MandelbrotViewport &viewport = result.viewport;
+    updateAxes(image.size(), viewport);
+    m_image = image;
+    m_pixmap = QPixmap::fromImage(image);
+    m_pixmapViewport = viewport;
+    m_viewport = viewport;
+    updatePixmap();
+}
+
+/**
+ * Replaces the coarse passes of a canceled calculation by the last complete image.
+ */
+void MandelbrotView::restoreImage()
+{
+    if(m_pixmap.isNull()) return;
+
+    m_image = m_pixmap.toImage();
+    m_viewport = m_pixmapViewport;
+    updatePixmap();
+}
+
+/**
+ * @param isPanMode true to move the region by dragging it, false to select a region to zoom in.
+ */
+void MandelbrotView::setPanMode(bool isPanMode)
+{
+    m_isPanMode = isPanMode;
+    m_isPressed = false;
+    updatePixmap();
 }
 
 void MandelbrotView::showEvent(QShowEvent *event)
 {
     Q_UNUSED(event);
 
-    double xmin = m_mandelbrotSet->getXmin();
-    double xmax = m_mandelbrotSet->getXmax();
-    double ymin = m_mandelbrotSet->getYmin();
-    double ymax = m_mandelbrotSet->getYmax();
-
-    emit updateNeeded(xmin, xmax, ymin, ymax);
+    emit updateNeeded(m_viewport);
 }
 
 void MandelbrotView::mousePressEvent(QMouseEvent *mouseEvent)
 {
-    if(m_isBusy) return;
-    if(m_pixmap.isNull()) return;
+    if(m_image.isNull()) return;
 
     m_isPressed = true;
     m_startZoom = ui->centralView->mapFromParent(mouseEvent->pos());
@@ -123,7 +205,12 @@ void MandelbrotView::mouseMoveEvent(QMouseEvent *mouseEvent)
     ui->horizontalAxis->setCursorPos(pos.x());
     ui->verticalAxis->setCursorPos(pos.y());
 
-    if(m_isBusy) return;
+    // The wheel zoom and the pan keep the point under the cursor in place,
+    // so that its position in the image stays valid for the next one.
+    if(!m_image.isNull() && m_image.rect().contains(pos)) {
+        m_focus = QPointF((pos.x() + 0.5) / m_image.width(), (pos.y() + 0.5) / m_image.height());
+    }
+
     if(!m_isPressed) return;
 
     m_endZoom = pos;
@@ -133,7 +220,6 @@ void MandelbrotView::mouseMoveEvent(QMouseEvent *mouseEvent)
 
 void MandelbrotView::mouseReleaseEvent(QMouseEvent *mouseEvent)
 {
-    if(m_isBusy) return;
     if(!m_isPressed) return;
 
     m_isPressed = false;
@@ -142,7 +228,11 @@ void MandelbrotView::mouseReleaseEvent(QMouseEvent *mouseEvent)
     constrainInPixmap(m_endZoom);
     updatePixmap();
 
-    if( fabs(m_endZoom.x() - m_startZoom.x()) >= 5 &&
+    if(m_isPanMode) {
+        if(m_endZoom != m_startZoom) {
+            pan();
+        }
+    }else if( fabs(m_endZoom.x() - m_startZoom.x()) >= 5 &&
             fabs(m_endZoom.y() - m_startZoom.y()) >= 5) {
         zoom();
     }
@@ -151,21 +241,16 @@ void MandelbrotView::mouseReleaseEvent(QMouseEvent *mouseEvent)
 void MandelbrotView::zoom()
 {
 
-    double xmin = m_mandelbrotSet->getXmin();
-    double xmax = m_mandelbrotSet->getXmax();
-    double ymin = m_mandelbrotSet->getYmin();
-    double ymax = m_mandelbrotSet->getYmax();
-
-    double dx = xmax - xmin;
-    double dy = ymax - ymin;
+    // The selection is expressed as fractions of the current region,
+    // which stay accurate however deep the zoom goes.
     double startZoomX = m_startZoom.x();
-    double startZoomY = m_pixmap.height() - m_startZoom.y() - 1;
+    double startZoomY = m_image.height() - m_startZoom.y() - 1;
     double endZoomX = m_endZoom.x();
-    double endZoomY = m_pixmap.height() - m_endZoom.y() - 1;
-    double newXmin = xmin + (dx * startZoomX) / m_pixmap.width();
-    double newYmin = ymin + (dy * startZoomY) / m_pixmap.height();
-    double newXmax = xmin + (dx * endZoomX) / m_pixmap.width();
-    double newYmax = ymin + (dy * endZoomY) / m_pixmap.height();
+    double endZoomY = m_image.height() - m_endZoom.y() - 1;
+    double newXmin = startZoomX / m_image.width();
+    double newYmin = startZoomY / m_image.height();
+    double newXmax = endZoomX / m_image.width();
+    double newYmax = endZoomY / m_image.height();
     if(newXmin > newXmax) {
         std::swap(newXmax, newXmin);
     }
@@ -173,28 +258,101 @@ void MandelbrotView::zoom()
         std::swap(newYmax, newYmin);
     }
 
-    emit updateNeeded(newXmin, newXmax, newYmin, newYmax);
+    // The selection ends up centered.
+    m_focus = QPointF(0.5, 0.5);
+    emit updateNeeded(m_viewport.getSubViewport(newXmin, newXmax, newYmin, newYmax), true);
+}
+
+/**
+ * The wheel zooms in or out by 2 around the cursor.
+ * The new region is aligned on the pixels of the current one, so that
+ * the pixels already computed are reused.
+ */
+void MandelbrotView::wheelEvent(QWheelEvent *wheelEvent)
+{
+    if(m_image.isNull()) return;
+
+    QPoint pos = ui->centralView->mapFromParent(wheelEvent->pos());
+    constrainInPixmap(pos);
+    int w = m_image.width();
+    int h = m_image.height();
+    int x = pos.x();
+    int y = h - pos.y() - 1;
+    m_focus = QPointF((pos.x() + 0.5) / w, (pos.y() + 0.5) / h);
+
+    // The pixel under the cursor stays in place.
+    if(wheelEvent->angleDelta().y() > 0) {
+        double startX = x - x/2;
+        double startY = y - y/2;
+        emit updateNeeded(m_viewport.getSubViewport(
+                              startX / w, startX / w + 0.5, startY / h, startY / h + 0.5), true);
+    }else if(wheelEvent->angleDelta().y() < 0) {
+        emit updateNeeded(m_viewport.getSubViewport(
+                              -(double)x / w, 2 - (double)x / w, -(double)y / h, 2 - (double)y / h), true);
+    }
+}
+
+void MandelbrotView::leaveEvent(QEvent *event)
+{
+    Q_UNUSED(event);
+
+    m_focus = QPointF(0.5, 0.5);
+}
+
+/**
+ * The region is moved by a whole number of pixels,
+ * so that the overlapping pixels are reused.
+ */
+void MandelbrotView::pan()
+{
+    QPoint move = m_endZoom - m_startZoom;
+    double fx = -(double)move.x() / m_image.width();
+    double fy = (double)move.y() / m_image.height();
+
+    emit updateNeeded(m_viewport.getTranslatedViewport(fx, fy), true);
 }
 
 void MandelbrotView::unzoom()
 {
-    emit updateNeeded(-2, 2, -2, 2);
+    emit updateNeeded(MandelbrotViewport(-2, 2, -2, 2));
+}
+
+/**
+ * @param size Size of the image in pixels.
+ * @param viewport Region of the complex plane shown by the image.
+ */
+void MandelbrotView::updateAxes(const QSize &size, const MandelbrotViewport &viewport)
+{
+    ui->horizontalAxis->setLength(size.width());
+    ui->verticalAxis->setLength(size.height());
+    ui->horizontalAxis->setRange(viewport.getXmin(), viewport.getXmax());
+    ui->verticalAxis->setRange(viewport.getYmin(), viewport.getYmax());
+    ui->horizontalAxis->setZoomFactor(viewport.getZoomFactor());
+    ui->verticalAxis->setZoomFactor(viewport.getZoomFactor());
 }
 
 void MandelbrotView::constrainInPixmap(QPoint &point)
 {
     if(point.x() < 0) point.setX(0);
-    if(point.x() >= m_pixmap.width()) point.setX(m_pixmap.width()-1);
+    if(point.x() >= m_image.width()) point.setX(m_image.width()-1);
     if(point.y() < 0) point.setY(0);
-    if(point.y() >= m_pixmap.height()) point.setY(m_pixmap.height()-1);
+    if(point.y() >= m_image.height()) point.setY(m_image.height()-1);
 }
 
+/**
+ * The selection or the move being dragged is drawn over the image displayed,
+ * whose region is the one the interaction applies to.
+ */
 void MandelbrotView::updatePixmap()
 {
 
-    QPixmap pixmap(m_pixmap);
+    QPixmap pixmap = QPixmap::fromImage(m_image);
 
-    if(m_isPressed) {
+    if(m_isPressed && m_isPanMode) {
+        pixmap.fill(QColor(0, 0, 0));
+        QPainter painter(&pixmap);
+        painter.drawImage(m_endZoom - m_startZoom, m_image);
+    }else if(m_isPressed) {
         QPainter painter(&pixmap);
 
         painter.setPen(QColor(255,255,255));
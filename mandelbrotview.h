@@ -3,6 +3,10 @@
 
 #include <QWidget>
 #include <QPixmap>
+#include <QPointF>
+
+#include "mandelbrotviewport.h"
+#include "mandelbrotrenderengine.h"
 
 namespace Ui {
 class MandelbrotView;
@@ -16,6 +20,9 @@ class MandelbrotSet;
  *
  * This widget displays the mandelbrot set along with two axes.
  * It also allows to interact with the set for zooming in.
+ *
+ * The images are computed by a MandelbrotRenderEngine, the widgets
+ * being only updated from the GUI thread when its results arrive.
  */
 class MandelbrotView : public QWidget
 {
@@ -26,15 +33,26 @@ public:
     ~MandelbrotView();
 
     MandelbrotSet *getMandelbrotSet();
+    MandelbrotRenderEngine *getRenderEngine();
 
     QPixmap getPixmap();
+    MandelbrotViewport getViewport() const;
 
-    void update(double xmin, double xmax, double ymin, double ymax);
+    void update(const MandelbrotViewport &viewport, bool isPreview = false);
+    void cancel();
     void unzoom();
 
+public slots:
+
+    void showImage(const QImage &image, const MandelbrotViewport &viewport);
+    void showTiles();
+    void showCompleteImage(const QImage &image, const MandelbrotRenderResult &result);
+    void restoreImage();
+    void setPanMode(bool isPanMode);
+
 signals:
 
-    void updateNeeded(double xmin, double xmax, double ymin, double ymax);
+    void updateNeeded(const MandelbrotViewport &viewport, bool isPreview = false);
 
 protected:
     void showEvent(QShowEvent *event);
@@ -42,22 +60,30 @@ protected:
     void mousePressEvent(QMouseEvent *mouseEvent);
     void mouseMoveEvent(QMouseEvent *mouseEvent);
     void mouseReleaseEvent(QMouseEvent *mouseEvent);
+    void wheelEvent(QWheelEvent *wheelEvent);
+    void leaveEvent(QEvent *event);
 
     void constrainInPixmap(QPoint &point);
     void updatePixmap();
     void zoom();
+    void pan();
+    void updateAxes(const QSize &size, const MandelbrotViewport &viewport);
 
 
 private:
     Ui::MandelbrotView *ui;
 
 
-    MandelbrotSet *m_mandelbrotSet;
+    MandelbrotRenderEngine *m_renderEngine;
     QPixmap m_pixmap;
-    bool m_isBusy;
+    QImage m_image;
+    MandelbrotViewport m_pixmapViewport;
+    MandelbrotViewport m_viewport;
     bool m_isPressed;
+    bool m_isPanMode;
     QPoint m_startZoom;
     QPoint m_endZoom;
+    QPointF m_focus;
 };
 
 #endif // MANDELBROTVIEW_H
@@ -0,0 +1,125 @@
+#include "mandelbrotviewport.h"
+
+MandelbrotViewport::MandelbrotViewport()
+{
+    m_width = 4;
+    m_height = 4;
+}
+
+/**
+ * @param xmin Start of the x coordinate range in the complex plane.
+ * @param xmax End of the x coordinate range in the complex plane.
+ * @param ymin Start of the y coordinate range in the complex plane.
+ * @param ymax End of the y coordinate range in the complex plane.
+ */
+MandelbrotViewport::MandelbrotViewport(double xmin, double xmax, double ymin, double ymax)
+{
+    m_width = xmax - xmin;
+    m_height = ymax - ymin;
+    int nFractionLimbs = MandelbrotBigFloat::getNFractionLimbsFor(std::min(m_width, m_height));
+    m_centerX = MandelbrotBigFloat(xmin, nFractionLimbs) + MandelbrotBigFloat(m_width / 2, nFractionLimbs);
+    m_centerY = MandelbrotBigFloat(ymin, nFractionLimbs) + MandelbrotBigFloat(m_height / 2, nFractionLimbs);
+}
+
+const MandelbrotBigFloat &MandelbrotViewport::getCenterX() const
+{
+    return m_centerX;
+}
+
+const MandelbrotBigFloat &MandelbrotViewport::getCenterY() const
+{
+    return m_centerY;
+}
+
+double MandelbrotViewport::getWidth() const
+{
+    return m_width;
+}
+
+double MandelbrotViewport::getHeight() const
+{
+    return m_height;
+}
+
+double MandelbrotViewport::getXmin() const
+{
+    return (m_centerX - MandelbrotBigFloat(m_width / 2, m_centerX.getNFractionLimbs())).toDouble();
+}
+
+double MandelbrotViewport::getXmax() const
+{
+    return (m_centerX + MandelbrotBigFloat(m_width / 2, m_centerX.getNFractionLimbs())).toDouble();
+}
+
+double MandelbrotViewport::getYmin() const
+{
+    return (m_centerY - MandelbrotBigFloat(m_height / 2, m_centerY.getNFractionLimbs())).toDouble();
+}
+
+double MandelbrotViewport::getYmax() const
+{
+    return (m_centerY + MandelbrotBigFloat(m_height / 2, m_centerY.getNFractionLimbs())).toDouble();
+}
+
+double MandelbrotViewport::getZoomFactor() const
+{
+    double zoomFactor = 1;
+    if(m_width > m_height) {
+        zoomFactor = 4. / m_width;
+    }else{
+        zoomFactor = 4. / m_height;
+    }
+    return zoomFactor;
+}
+
+/**
+ * The offset of the new center is computed as a double, which is accurate
+ * relative to the dimensions of the region, then added to the current
+ * center with enough bits to resolve the new dimensions.
+ *
+ * @param fxmin Start of the new x range, as a fraction of the width.
+ * @param fxmax End of the new x range, as a fraction of the width.
+ * @param fymin Start of the new y range, as a fraction of the height.
+ * @param fymax End of the new y range, as a fraction of the height.
+ * @return The new region.
+ */
+MandelbrotViewport MandelbrotViewport::getSubViewport(double fxmin, double fxmax, double fymin, double fymax) const
+{
+    MandelbrotViewport viewport;
+    viewport.m_width = (fxmax - fxmin) * m_width;
+    viewport.m_height = (fymax - fymin) * m_height;
+
+    int nFractionLimbs = MandelbrotBigFloat::getNFractionLimbsFor(std::min(viewport.m_width, viewport.m_height));
+    double dx = ((fxmin + fxmax) / 2 - 0.5) * m_width;
+    double dy = ((fymin + fymax) / 2 - 0.5) * m_height;
+    viewport.m_centerX = m_centerX + MandelbrotBigFloat(dx, nFractionLimbs);
+    viewport.m_centerY = m_centerY + MandelbrotBigFloat(dy, nFractionLimbs);
+    return viewport;
+}
+
+/**
+ * Unlike getSubViewport(), the dimensions are kept exactly as they are.
+ *
+ * @param fx Move along the x axis, as a fraction of the width.
+ * @param fy Move along the y axis, as a fraction of the height.
+ * @return The moved region.
+ */
+MandelbrotViewport MandelbrotViewport::getTranslatedViewport(double fx, double fy) const
+{
+    MandelbrotViewport viewport = *this;
+    int nFractionLimbs = MandelbrotBigFloat::getNFractionLimbsFor(std::min(m_width, m_height));
+    viewport.m_centerX = m_centerX + MandelbrotBigFloat(fx * m_width, nFractionLimbs);
+    viewport.m_centerY = m_centerY + MandelbrotBigFloat(fy * m_height, nFractionLimbs);
+    return viewport;
+}
+
+bool MandelbrotViewport::operator==(const MandelbrotViewport &other) const
+{
+    return m_width == other.m_width && m_height == other.m_height &&
+            m_centerX == other.m_centerX && m_centerY == other.m_centerY;
+}
+
+bool MandelbrotViewport::operator!=(const MandelbrotViewport &other) const
+{
+    return !(*this == other);
+}
@@ -0,0 +1,77 @@
+#ifndef MANDELBROTVIEWPORT_H
+#define MANDELBROTVIEWPORT_H
+
+#include "mandelbrotbigfloat.h"
+
+#include <QMetaType>
+
+/**
+ * @brief The MandelbrotViewport class.
+ *
+ * The region of the complex plane mapped to an image.
+ *
+ * The center of the region is held with as many bits as needed to tell
+ * its pixels apart, while its dimensions are plain doubles. This keeps
+ * the region exact however deep the zoom goes, well past the point where
+ * the boundaries can no longer be told apart as doubles.
+ */
+class MandelbrotViewport
+{
+public:
+
+    /** Constructor: the default region, from -2 to 2 along both axes. */
+    MandelbrotViewport();
+
+    /** Constructor from the boundaries of the region. */
+    MandelbrotViewport(double xmin, double xmax, double ymin, double ymax);
+
+    /** Get the real part of the center. */
+    const MandelbrotBigFloat &getCenterX() const;
+
+    /** Get the imaginary part of the center. */
+    const MandelbrotBigFloat &getCenterY() const;
+
+    /** Get the width of the region along the x (real) axis. */
+    double getWidth() const;
+
+    /** Get the height of the region along the y (imaginary) axis. */
+    double getHeight() const;
+
+    /** Get the lower boundary in the x coordinate system, rounded to a double. */
+    double getXmin() const;
+
+    /** Get the upper boundary in the x coordinate system, rounded to a double. */
+    double getXmax() const;
+
+    /** Get the lower boundary in the y coordinate system, rounded to a double. */
+    double getYmin() const;
+
+    /** Get the upper boundary in the y coordinate system, rounded to a double. */
+    double getYmax() const;
+
+    /** Get the zoom factor relative to the default region. */
+    double getZoomFactor() const;
+
+    /** Get a part of this region, given as fractions of its dimensions. */
+    MandelbrotViewport getSubViewport(double fxmin, double fxmax, double fymin, double fymax) const;
+
+    /** Get this region moved by given fractions of its dimensions. */
+    MandelbrotViewport getTranslatedViewport(double fx, double fy) const;
+
+    /** Check if two regions are equal. */
+    bool operator==(const MandelbrotViewport &other) const;
+
+    /** Check if two regions are different. */
+    bool operator!=(const MandelbrotViewport &other) const;
+
+protected:
+
+    MandelbrotBigFloat m_centerX; //!< Real part of the center.
+    MandelbrotBigFloat m_centerY; //!< Imaginary part of the center.
+    double m_width; //!< Width of the region.
+    double m_height; //!< Height of the region.
+};
+
+Q_DECLARE_METATYPE(MandelbrotViewport)
+
+#endif // MANDELBROTVIEWPORT_H
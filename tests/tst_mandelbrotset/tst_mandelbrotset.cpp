@@ -0,0 +1,336 @@
+#include <QtTest>
+
+#include "mandelbrotset.h"
+#include "mandelbrotthemeinfo.h"
+#include "mandelbrotkernel.h"
+#include "mandelbrotsimdkernel.h"
+
+/**
+ * @brief The TestMandelbrotSet class.
+ *
+ * Checks that the shortcuts of the rendering methods give the same image as
+ * a convergence test of every pixel, that the resumed orbits give the
+ * same results as a calculation performed with the higher precision,
+ * that the vectorized tests give the same results as the scalar ones,
+ * that the double-double tests go deeper than the double ones, and that
+ * the fields left out by a theme do not change the escape times.
+ */
+class TestMandelbrotSet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void boundaryTracing_data();
+    void boundaryTracing();
+    void resumedOrbits();
+    void vectorizedTest();
+    void doubleDoubleShallowZoom();
+    void doubleDoubleDeepZoom();
+    void escapeTimeFields_data();
+    void escapeTimeFields();
+
+private:
+
+    static MandelbrotViewport getViewport();
+    static int countDifferences(const MandelbrotPointBuffer &buffer, const MandelbrotPointBuffer &expected);
+    static std::vector<int> render(MandelbrotThemeInfo::ThemeType themeType, MandelbrotThemeInfo::RenderingMethod renderingMethod,
+                                   const MandelbrotViewport &viewport, const MandelbrotViewport *previousViewport);
+};
+
+static const int s_width = 160;
+static const int s_height = 120;
+static const int s_precision = 3000;
+
+/**
+ * The region holds small islands of slow escape times, enclosed by regions of
+ * a single escape time, and many points which run out of iterations.
+ *
+ * @return The region of the complex plane rendered by the tests.
+ */
+MandelbrotViewport TestMandelbrotSet::getViewport()
+{
+    double width = 8.171e-4;
+    double height = width * s_height / s_width;
+    double centerX = -1.20022114096;
+    double centerY = 0.15542252369;
+    return MandelbrotViewport(centerX - width/2, centerX + width/2, centerY - height/2, centerY + height/2);
+}
+
+/**
+ * @param buffer Results to be checked.
+ * @param expected Expected results.
+ * @return The number of points of which a field is not exactly the expected one.
+ */
+int TestMandelbrotSet::countDifferences(const MandelbrotPointBuffer &buffer, const MandelbrotPointBuffer &expected)
+{
+    if(buffer.size() != expected.size()) return expected.size();
+
+    int nDifferences = 0;
+    for(int k=0; k<expected.size(); k++) {
+        MandelbrotPoint p = buffer.get(k);
+        MandelbrotPoint q = expected.get(k);
+        if(p.n != q.n || p.r != q.r || p.de != q.de) nDifferences++;
+    }
+    return nDifferences;
+}
+
+/**
+ * @param themeType Type of the theme, which selects the fields computed.
+ * @param renderingMethod Rendering method of the theme.
+ * @param viewport Region of the complex plane to be rendered.
+ * @param previousViewport Region rendered before, whose pixels are reused, null if none.
+ * @return The escape time of each pixel.
+ */
+std::vector<int> TestMandelbrotSet::render(MandelbrotThemeInfo::ThemeType themeType, MandelbrotThemeInfo::RenderingMethod renderingMethod,
+                                           const MandelbrotViewport &viewport, const MandelbrotViewport *previousViewport)
+{
+    MandelbrotThemeInfo themeInfo;
+    themeInfo.setThemeType(themeType);
+    themeInfo.setRenderingMethod(renderingMethod);
+
+    MandelbrotSet mandelbrotSet;
+    mandelbrotSet.setPrecision(s_precision);
+    mandelbrotSet.setThemeInfo(themeInfo);
+
+    QImage image(s_width, s_height, QImage::Format_RGB32);
+    if(previousViewport) {
+        mandelbrotSet.fillPixmap(image, *previousViewport);
+    }
+    mandelbrotSet.fillPixmap(image, viewport);
+
+    std::vector<int> escapeTimes(s_width * s_height);
+    for(int k=0; k<s_width*s_height; k++) {
+        escapeTimes[k] = mandelbrotSet.getBuffer().getN(k);
+    }
+    return escapeTimes;
+}
+
+void TestMandelbrotSet::boundaryTracing_data()
+{
+    QTest::addColumn<bool>("isReusing");
+
+    QTest::newRow("computed") << false;
+    QTest::newRow("reused") << true;
+}
+
+/**
+ * The islands of slow escape times are only found by comparing the pixels
+ * computed by the coarse passes.
+ */
+void TestMandelbrotSet::boundaryTracing()
+{
+    QFETCH(bool, isReusing);
+
+    MandelbrotViewport viewport = getViewport();
+    MandelbrotViewport previousViewport = viewport.getTranslatedViewport(0.13, 0.07);
+    const MandelbrotViewport *previous = isReusing ? &previousViewport : 0;
+
+    std::vector<int> expected = render(MandelbrotThemeInfo::EscapeTime, MandelbrotThemeInfo::FullRendering, viewport, previous);
+    std::vector<int> traced = render(MandelbrotThemeInfo::EscapeTime, MandelbrotThemeInfo::BoundaryTracing, viewport, previous);
+
+    int nDifferences = 0;
+    for(unsigned int k=0; k<expected.size(); k++) {
+        if(traced[k] != expected[k]) nDifferences++;
+    }
+    QCOMPARE(nDifferences, 0);
+}
+
+/**
+ * The points which ran out of iterations carry on from where their orbit
+ * stopped when the precision is doubled, which must give, bit for bit,
+ * the results of a calculation performed with the doubled precision.
+ */
+void TestMandelbrotSet::resumedOrbits()
+{
+    MandelbrotViewport viewport = getViewport();
+    MandelbrotThemeInfo themeInfo;
+    themeInfo.setThemeType(MandelbrotThemeInfo::Distance);
+    QImage image(s_width, s_height, QImage::Format_RGB32);
+
+    MandelbrotSet resumed;
+    resumed.setResumable(true);
+    resumed.setThemeInfo(themeInfo);
+    resumed.setPrecision(s_precision / 2);
+    resumed.fillPixmap(image, viewport);
+    resumed.setPrecision(s_precision);
+    resumed.fillPixmap(image, viewport);
+
+    MandelbrotSet computed;
+    computed.setResumable(true);
+    computed.setThemeInfo(themeInfo);
+    computed.setPrecision(s_precision);
+    computed.fillPixmap(image, viewport);
+
+    QCOMPARE(resumed.getPrecisionTier(), MandelbrotSet::DoubleTier);
+    QCOMPARE(countDifferences(resumed.getBuffer(), computed.getBuffer()), 0);
+}
+
+/**
+ * The points of the region are tested in batches, one per column as in
+ * the calculations of the set, and one by one by the scalar test: every
+ * field must be the same. The region crosses the boundary of the set, so
+ * that the batches mix escaping points with converged ones, whose orbit
+ * is found to be periodic.
+ */
+void TestMandelbrotSet::vectorizedTest()
+{
+    MandelbrotSimdKernel::BatchTest batchTest = MandelbrotSimdKernel::select(2);
+    if(!batchTest) {
+        QSKIP("No vector instructions available");
+    }
+    MandelbrotKernel::ConvergenceTest test = MandelbrotKernel::select(2);
+
+    MandelbrotViewport viewport = getViewport();
+    double pixelSpacing = viewport.getWidth() / s_width;
+    MandelbrotKernelParams params;
+    params.precision = s_precision;
+    params.order = 2;
+    params.periodicityTolerance2 = pixelSpacing * pixelSpacing * 1e-6;
+    params.fields = MandelbrotSet::AllFields;
+    MandelbrotKernelStats stats = { 0, 0 };
+
+    std::vector<double> x0(s_height);
+    std::vector<double> y0(s_height);
+    std::vector<MandelbrotPoint> points(s_height);
+    int nDifferences = 0;
+    int nConverged = 0;
+    for(int i=0; i<s_width; i++) {
+        for(int j=0; j<s_height; j++) {
+            x0[j] = viewport.getXmin() + i * pixelSpacing;
+            y0[j] = viewport.getYmax() - j * pixelSpacing;
+        }
+        batchTest(&x0[0], &y0[0], s_height, &points[0], params, stats);
+        for(int j=0; j<s_height; j++) {
+            MandelbrotPoint expected = test(x0[j], y0[j], params, stats);
+            if(points[j].n != expected.n || points[j].r != expected.r || points[j].de != expected.de) nDifferences++;
+            if(expected.n < 0) nConverged++;
+        }
+    }
+
+    QVERIFY(nConverged > 0 && nConverged < s_width * s_height);
+    QCOMPARE(nDifferences, 0);
+}
+
+/**
+ * Where doubles are accurate enough, the double-double test must give the
+ * escape times of the double test. The default region is used: the slow
+ * escape times of the deeper regions amplify the rounding errors.
+ */
+void TestMandelbrotSet::doubleDoubleShallowZoom()
+{
+    MandelbrotKernel::ConvergenceTest test = MandelbrotKernel::select(2);
+
+    MandelbrotViewport viewport;
+    double xSpacing = viewport.getWidth() / s_width;
+    double ySpacing = viewport.getHeight() / s_height;
+    MandelbrotKernelParams params;
+    params.precision = s_precision;
+    params.order = 2;
+    params.periodicityTolerance2 = xSpacing * xSpacing * 1e-6;
+    params.fields = MandelbrotSet::AllFields;
+    MandelbrotKernelStats stats = { 0, 0 };
+
+    int nDifferences = 0;
+    for(int i=0; i<s_width; i++) {
+        for(int j=0; j<s_height; j++) {
+            double x0 = viewport.getXmin() + i * xSpacing;
+            double y0 = viewport.getYmax() - j * ySpacing;
+            MandelbrotPoint expected = test(x0, y0, params, stats);
+            MandelbrotPoint p = MandelbrotKernel::doubleDoubleTest(MandelbrotKernel::DoubleDouble(x0, 0),
+                                                                   MandelbrotKernel::DoubleDouble(y0, 0), params, stats);
+            if(p.n != expected.n) nDifferences++;
+        }
+    }
+    QCOMPARE(nDifferences, 0);
+}
+
+/**
+ * Past the resolution of doubles, neighboring pixels are rounded to the same
+ * coordinates and their columns are repeated. The set switches to double-doubles,
+ * which must tell apart more columns than the double test can.
+ */
+void TestMandelbrotSet::doubleDoubleDeepZoom()
+{
+    MandelbrotViewport viewport = getViewport().getSubViewport(0.5 - 8e-12, 0.5 + 8e-12, 0.5 - 8e-12, 0.5 + 8e-12);
+    MandelbrotThemeInfo themeInfo;
+    themeInfo.setThemeType(MandelbrotThemeInfo::EscapeTime);
+    QImage image(s_width, s_height, QImage::Format_RGB32);
+
+    MandelbrotSet mandelbrotSet;
+    mandelbrotSet.setPrecision(s_precision);
+    mandelbrotSet.setThemeInfo(themeInfo);
+    mandelbrotSet.fillPixmap(image, viewport);
+    QCOMPARE(mandelbrotSet.getPrecisionTier(), MandelbrotSet::DoubleDoubleTier);
+    const MandelbrotPointBuffer &buffer = mandelbrotSet.getBuffer();
+
+    MandelbrotKernel::ConvergenceTest test = MandelbrotKernel::select(2);
+    double pixelSpacing = viewport.getWidth() / s_width;
+    MandelbrotKernelParams params;
+    params.precision = s_precision;
+    params.order = 2;
+    params.periodicityTolerance2 = pixelSpacing * pixelSpacing * 1e-6;
+    params.fields = MandelbrotSet::EscapeTimeOnly;
+    MandelbrotKernelStats stats = { 0, 0 };
+
+    std::vector<int> escapeTimes(s_width * s_height);
+    for(int i=0; i<s_width; i++) {
+        for(int j=0; j<s_height; j++) {
+            double x0 = viewport.getXmin() + i * pixelSpacing;
+            double y0 = viewport.getYmax() - j * pixelSpacing;
+            escapeTimes[i*s_height + j] = test(x0, y0, params, stats).n;
+        }
+    }
+
+    int nColumns = 1;
+    int nDoubleColumns = 1;
+    for(int i=1; i<s_width; i++) {
+        bool isNewColumn = false;
+        bool isNewDoubleColumn = false;
+        for(int j=0; j<s_height; j++) {
+            int k = i*s_height + j;
+            if(buffer.getN(k) != buffer.getN(k - s_height)) isNewColumn = true;
+            if(escapeTimes[k] != escapeTimes[k - s_height]) isNewDoubleColumn = true;
+        }
+        if(isNewColumn) nColumns++;
+        if(isNewDoubleColumn) nDoubleColumns++;
+    }
+    QVERIFY(nColumns > nDoubleColumns);
+}
+
+void TestMandelbrotSet::escapeTimeFields_data()
+{
+    QTest::addColumn<bool>("isDeep");
+
+    QTest::newRow("single precision") << false;
+    QTest::newRow("double precision") << true;
+}
+
+/**
+ * The escape time themes skip the derivative of the orbits, which the distance
+ * estimation themes need: the orbits must escape at the same iteration.
+ * Zooming in past the limit of the single precision tests checks the double
+ * precision ones as well.
+ */
+void TestMandelbrotSet::escapeTimeFields()
+{
+    QFETCH(bool, isDeep);
+
+    MandelbrotViewport viewport = getViewport();
+    if(isDeep) {
+        viewport = viewport.getSubViewport(0.4, 0.6, 0.4, 0.6);
+    }
+
+    std::vector<int> expected = render(MandelbrotThemeInfo::Distance, MandelbrotThemeInfo::FullRendering, viewport, 0);
+    std::vector<int> escapeTimes = render(MandelbrotThemeInfo::EscapeTime, MandelbrotThemeInfo::FullRendering, viewport, 0);
+
+    int nDifferences = 0;
+    for(unsigned int k=0; k<expected.size(); k++) {
+        if(escapeTimes[k] != expected[k]) nDifferences++;
+    }
+    QCOMPARE(nDifferences, 0);
+}
+
+QTEST_GUILESS_MAIN(TestMandelbrotSet)
+
+#include "tst_mandelbrotset.moc"
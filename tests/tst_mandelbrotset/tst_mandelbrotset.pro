@@ -0,0 +1,51 @@
+#-------------------------------------------------
+#
+# Tests of the calculations of the Mandelbrot set
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
+TARGET = tst_mandelbrotset
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_mandelbrotset.cpp \
+    ../../mandelbrotset.cpp \
+    ../../mandelbrotthememanager.cpp \
+    ../../mandelbrotthemeinfo.cpp \
+    ../../mandelbrottheme.cpp \
+    ../../mandelbrottilescheduler.cpp \
+    ../../mandelbrotkernel.cpp \
+    ../../mandelbrotsimdkernel.cpp \
+    ../../mandelbrotbigfloat.cpp \
+    ../../mandelbrotviewport.cpp \
+    ../../mandelbrotperturbation.cpp \
+    ../../mandelbrotpointbuffer.cpp \
+    ../../mandelbrottilequeue.cpp
+
+HEADERS += \
+    ../../mandelbrotset.h \
+    ../../mandelbrotthememanager.h \
+    ../../mandelbrotthemeinfo.h \
+    ../../mandelbrottheme.h \
+    ../../mandelbrottilescheduler.h \
+    ../../mandelbrotkernel.h \
+    ../../mandelbrotsimdkernel.h \
+    ../../mandelbrotbigfloat.h \
+    ../../mandelbrotviewport.h \
+    ../../mandelbrotperturbation.h \
+    ../../mandelbrotdoubledouble.h \
+    ../../mandelbrotpointbuffer.h \
+    ../../mandelbrottilequeue.h
+
+# Same arithmetic as the application.
+*-g++*|*-clang*: QMAKE_CXXFLAGS += -ffp-contract=off